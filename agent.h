@@ -14,8 +14,21 @@
 #include <map>
 #include <type_traits>
 #include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include "board.h"
 #include "action.h"
+#include "transposition.h"
+#include "batch.h"
+#include "playout.h"
+#include "pattern.h"
+#include "record.h"
+#include "timer.h"
+#include "arena.h"
 #include <fstream>
 #include <unistd.h>
 #include <ctime>
@@ -38,6 +51,9 @@ public:
 	virtual void close_episode(const std::string& flag = "") {}
 	virtual action take_action(const board& b) { return action(); }
 	virtual bool check_for_win(const board& b) { return false; }
+	virtual void ponder(const board& b) {}
+	virtual void stop() {}
+	virtual void interrupt() {}
 
 public:
 	virtual std::string property(const std::string& key) const { return meta.at(key); }
@@ -78,281 +94,748 @@ protected:
 class player : public random_agent {
 public:
 	player(const std::string& args = "") :random_agent("name=random role=unknown " + args),
-		space(board::size_x * board::size_y), opp_space(board::size_x * board::size_y), who(board::empty) {
+		who(board::empty), opp(board::empty), table(meta.count("tt") ? size_t(meta["tt"]) : 65536),
+		nodes(meta.count("slab") ? size_t(meta["slab"]) : arena::huge_page, meta.count("huge") && property("huge") == "y"),
+		spare(meta.count("slab") ? size_t(meta["slab"]) : arena::huge_page, meta.count("huge") && property("huge") == "y"),
+		time_control(meta.count("move_time") ? double(meta["move_time"]) : 1) {
 		if (name().find_first_of("[]():; ") != std::string::npos)
 			throw std::invalid_argument("invalid name: " + name());
 		if (role() == "black") who = board::black;
 		if (role() == "white") who = board::white;
 		if (who == board::empty)
 			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++){
-			space[i] = action::place(i, who);
-			//create opponet space
-			if(who == board::black) opp_space[i] = action::place(i, board::white);
-			if(who == board::white) opp_space[i] = action::place(i, board::black);
+		opp = static_cast<board::piece_type>(3u - who);
+		if (meta.count("time")) time_control.settings(double(meta["time"]), 0, 0);
+		if (meta.count("pattern")) { // the records are either binary or text, see record
+			size_t games = 0;
+			if (record::is_binary(property("pattern"))) {
+				record_file file(property("pattern"));
+				games = patterns.learn(file);
+			} else {
+				std::ifstream in(property("pattern"));
+				if (in) games = patterns.learn(in);
+			}
+			if (games == 0)
+				throw std::invalid_argument("invalid pattern records: " + property("pattern"));
 		}
 	}
-	virtual action take_action(const board& state) {
-		simulation_count = stoi(property("N"));
-		weight = stof(property("c"));
-		timer = property("timer");
-		choose = property("choose");
-		node* root = new_node(state);
+	virtual ~player() { stop(); }
 
+	/**
+	 * whether the player has won after its move, i.e., the opponent has no legal move
+	 */
+	virtual bool check_for_win(const board& state) { return state.legal_moves(opp).empty(); }
+	virtual void open_episode(const std::string& flag = "") { stop(); interrupted = false; banked = 0; delete_nodes(); }
+	virtual void close_episode(const std::string& flag = "") { stop(); interrupted = false; banked = 0; delete_nodes(); time_control.reset(); }
+
+	/**
+	 * besides setting properties, accept the GTP time settings as
+	 * "time_settings=main_time byo_yomi_time byo_yomi_stones" and "time_left=time stones"
+	 */
+	virtual void notify(const std::string& msg) {
+		random_agent::notify(msg);
+		std::stringstream in(msg.substr(msg.find('=') + 1));
+		double time, byoyomi;
+		unsigned stones;
+		if (msg.find("time_settings=") == 0 && in >> time >> byoyomi >> stones) time_control.settings(time, byoyomi, stones);
+		if (msg.find("time_left=") == 0 && in >> time >> stones) time_control.left(time, stones);
+	}
+	virtual action take_action(const board& state) {
+		stop();
+		configure();
+		stopped = false; // cleared before the search, so that a later stop is never lost
+		total_count = 0;
+		bitboard moves = state.legal_moves(who);
 		if(timer=="y"){
-			std::clock_t start = std::clock(); // get current time
-			while(1){
-				my_turn = true;
-				update_nodes.push_back(root);
-				insert(root,state);
-				if( (std::clock()-start)/ (double) CLOCKS_PER_SEC > 1) {
-					// //std::cout<<total_count<<std::endl;
-					break;
-				}
-			}
-			std::cout<<"total_count ="<<total_count<<std::endl;
+			time_control.start((moves.count() + 1) / 2); // about half of the legal moves will be played by each side
+			last_best = nullptr;
+		}
+		// a quarter of the simulations saved by the previous moves is spent on this move
+		simulation_budget = simulation_count + banked / 4;
+		int winning = -1; // a move after which the opponent has no legal move
+		for(bitboard rest = moves; rest.any() && winning == -1 && moves.count() > 1; ){
+			board after = state;
+			unsigned move = rest.pop();
+			if(after.place(board::point(move)) == board::legal && after.legal_moves(opp).empty()) winning = move;
+		}
+		if(moves.count()==1 || winning!=-1){ // no need to think
+			if(timer=="y") time_control.finish();
+			else banked += simulation_count;
+			report(winning!=-1 ? "winning move" : "single legal move", timer=="y" ? time_control.allocated() : simulation_budget);
+			return action::place(winning!=-1 ? winning : moves.first(), who);
+		}
+		// the search runs in the orientation of the root node, which may be symmetric to the state
+		unsigned symmetry = 0;
+		node* root = reuse ? reuse_node(state, symmetry) : nullptr;
+		if (!root) {
+			delete_nodes();
+			root = find_node(state, symmetry);
+		}
+		board root_state = state;
+		root_state.transform(symmetry);
+		if(!solution(root)) search_all(root, root_state, false); // nothing to search if the root has been solved
+		if(timer=="y"){
+			time_control.finish();
+			std::cerr<<"total_count ="<<total_count<<", time ="<<time_control.elapsed()<<"/"<<time_control.allocated()<<std::endl;
+			double saved = time_control.allocated() - time_control.elapsed();
+			const char* reason = solution(root) ? "solved" : time_control.stopped();
+			if(saved > 0 && *reason) report(reason, saved);
 		}
 		else if(timer=="n"){
-			while(total_count<simulation_count){
-				my_turn = true;
-				update_nodes.push_back(root);
-				insert(root,state);
-			}
+			banked = std::max(banked + simulation_count - total_count, 0);
+			if(total_count < simulation_budget) report(solution(root) ? "solved" : "settled", simulation_budget - total_count);
 		}
 
 		total_count = 0;
-		if(root->childs.size()==0) return action();
+		if(root->childs.size()==0){
+			if (!reuse) delete_nodes();
+			return action();
+		}
 
 		//choose best child 
 		int index = -1;
 		float max=-100;
+		// play a proven winning move at once, and avoid the proven losing moves unless all moves lose
+		bool hopeless = true;
+		for(size_t i = 0 ; i <root->childs.size(); i++){
+			if(solution(root->childs[i].child)==proven_loss) index = i;
+			if(solution(root->childs[i].child)!=proven_win) hopeless = false;
+		}
 		
-		if(choose=="win_rate"){
+		if(index==-1 && choose=="win_rate"){
 			for(size_t i = 0 ; i <root->childs.size(); i++){
-				float cuurent_win_rate = root->childs[i]->win_count / root->childs[i]->visit_count ;
+				if(losing(root->childs[i], hopeless)) continue;
+				float cuurent_win_rate = float(root->childs[i].child->win_count) / root->childs[i].child->visit_count ;
 				if(cuurent_win_rate>max){
 					max = cuurent_win_rate;
 					index = i;
 				}
 			}
 		}
-		else if(choose=="visit_count"){
+		else if(index==-1 && choose=="visit_count"){
 			for(size_t i = 0 ; i <root->childs.size(); i++){
-				if(root->childs[i]->visit_count>max){
-					max = root->childs[i]->visit_count;
+				if(losing(root->childs[i], hopeless)) continue;
+				if(root->childs[i].child->visit_count>max){
+					max = root->childs[i].child->visit_count;
 					index = i;
 				}
 			}
 		}
-		else if(choose=="uct_value"){
+		else if(index==-1 && choose=="uct_value"){
 			for(size_t i = 0 ; i <root->childs.size(); i++){
-				if(root->childs[i]->uct_value>max){
-					max = root->childs[i]->uct_value;
+				if(losing(root->childs[i], hopeless)) continue;
+				if(root->childs[i].child->uct_value>max){
+					max = root->childs[i].child->uct_value;
 					index = i;
 				}
 			}
 		}
-		// //std::cout<<"root->childs.size():"<<root->childs.size()<<std::endl;
-		// //std::cout<<"！！！！！！！！action index :"<<index<<std::endl;
-		// //std::cout<<"ORG"<<std::endl;
-		// //std::cout<<state<<std::endl;
-		// //std::cout<<"It shoud be"<<std::endl;
-		// //std::cout<<root->childs[index]->state<<std::endl;
-		for (const action::place& move : space) {
-			board after = state;
-			if (move.apply(after) == board::legal){
-				if(after == root->childs[index]->state){
-					delete_node(root);
-					return move;
-				}
-			}
-		}
-		delete_node(root);
-		return action();
+		// map the move back from the orientation of the root node
+		unsigned i = 0;
+		while (board::geometry::symmetry[symmetry][i] != root->childs[index].move) i++;
+		if (!reuse) delete_nodes();
+		return action::place(i, who);
+	}
+
+	/**
+	 * with ponder=y, keep searching the position in the background while the opponent is thinking,
+	 * the searched nodes are kept for the next take_action, which finds the reply of the opponent by reuse_node
+	 * pondering stops at the next take_action, stop, or after ponder_count simulations to bound the memory
+	 */
+	virtual void ponder(const board& state) {
+		stop();
+		if (!meta.count("ponder") || property("ponder") != "y") return;
+		if (state.legal_moves(state.info().who_take_turns).empty()) return; // the game is over
+		configure();
+		std::lock_guard<std::mutex> lock(background);
+		stopped = false; // cleared here rather than by the ponder thread, which may start after the next stop
+		pondering = std::thread(&player::think, this, state);
+	}
+
+	/**
+	 * stop pondering and wait for the background search
+	 */
+	virtual void stop() {
+		std::lock_guard<std::mutex> lock(background);
+		if (!pondering.joinable()) return;
+		stopped = true;
+		pondering.join();
+	}
+
+	/**
+	 * abort the search of take_action as soon as possible, which then returns the best move so far,
+	 * it may be called from another thread, and stays in effect until the episode is closed
+	 */
+	virtual void interrupt() {
+		interrupted = true;
+		stop();
 	}
 
+	/**
+	 * report why the search stopped early, and the seconds (timer=y) or the simulations (timer=n) saved
+	 * with timer=n, it is reported only if verbose=y
+	 */
+	void report(const char* reason, double saved){
+		if(timer=="n" && !(meta.count("verbose") && property("verbose") == "y")) return;
+		std::cerr<<"early stop: "<<reason<<", saved "<<saved<<(timer=="y" ? " seconds" : " simulations")<<std::endl;
+	}
+
+	/**
+	 * read the options of the search from the properties
+	 */
+	void configure() {
+		simulation_count = meta.count("N") ? stoi(property("N")) : 200;
+		weight = meta.count("c") ? stof(property("c")) : 0.1;
+		timer = meta.count("timer") ? property("timer") : "n";
+		choose = meta.count("choose") ? property("choose") : "visit_count";
+		batch = meta.count("batch") && property("batch") == "y";
+		reuse = meta.count("reuse") && property("reuse") == "y";
+		threads = meta.count("threads") ? std::max(int(meta["threads"]), 1) : 1;
+		rave = meta.count("rave") && (property("rave") == "1" || property("rave") == "y");
+		rave_k = meta.count("k") ? float(meta["k"]) : 500;
+		ponder_count = meta.count("ponder_count") ? int(meta["ponder_count"]) : 1000000;
+		bias = meta.count("bias") ? float(meta["bias"]) : (patterns.empty() ? 0 : 1);
+		reuse |= meta.count("ponder") && property("ponder") == "y"; // the pondered nodes are useless otherwise
+	}
+
+	enum proof { unsolved = 0, proven_win = 1, proven_loss = 2 }; // the result of the side to move of a node
+	struct node;
+	/**
+	 * a child of a node, with the move to the child from the position of the node
+	 * note that the child node may be shared by symmetric positions, so the position after the move
+	 * should be transformed by the symmetry to match the orientation of the child node
+	 */
+	struct edge{
+		struct node* child;
+		uint8_t move;
+		uint8_t symmetry;
+		float prior; // the weight of the pattern of the move, see pattern_table
+	};
+	/**
+	 * a node does not keep its position, which is replayed from the root along the edges,
+	 * but keeps its hash for identifying the orientation of the position
+	 */
 	struct node{
-		board state;
-		float visit_count;
-		float win_count;
+		uint64_t key; // the hash of the position in the orientation of the node
+		uint32_t visit_count;
+		uint32_t win_count;
+		uint32_t amaf_visits; // the all-moves-as-first counts of the move to this node, see update_amaf
+		uint32_t amaf_wins;
 		float uct_value;
-		std::vector<node*> childs;
+		uint8_t moves; // the number of legal moves, i.e., the number of children once fully expanded
+		uint8_t proven; // whether the side to move provably wins or loses, see solve
+		bitboard untried; // the legal moves that have not been expanded, only accessed while expanding
+		arena_array<edge> childs;
 	};
-	void delete_node(struct node * root){
-		for(size_t i = 0 ; i<root->childs.size(); i++)
-			delete_node(root->childs[i]);
-		delete(root);
-	}
-	bool simulation(struct node * current_node){
-		board after = current_node->state;
-		bool end = false;
-		bool win = true;
-		int count = 0 ;
-		// if(who == board::white) //debug<<"who == board::white"<<std::endl;
-		// if(who == board::black) //debug<<"who == board::black"<<std::endl;
-
-		if(my_turn==true) {
-			//debug<<"my_turn==true"<<std::endl;
-			//debug<<current_node->state<<std::endl;
-			win = false;
-			count = 0;
+	/**
+	 * the state of a search thread, i.e., the path being searched, the position and the side to move, and its random engine
+	 */
+	struct worker{
+		std::vector<node*> update_nodes;
+		std::vector<const edge*> update_edges; // update_edges[i] is the edge from update_nodes[i] to update_nodes[i + 1]
+		bitboard played[2]; // the positions played by black and white in the playout
+		board state;
+		bool my_turn;
+		xoshiro256 engine;
+	};
+
+	/**
+	 * search the position in the background, starting from the nodes searched by the previous moves
+	 */
+	void think(board state){
+		unsigned symmetry = 0;
+		node* root = reuse_node(state, symmetry);
+		if (!root) {
+			delete_nodes();
+			root = find_node(state, symmetry);
 		}
-		else {
-			//debug<<"my_turn==false"<<std::endl;
-			//debug<<current_node->state<<std::endl;
-			win = true;
-			count = 1;
+		state.transform(symmetry);
+		total_count = 0;
+		search_all(root, state, true);
+	}
+
+	/**
+	 * run the search with all the threads, the calling thread is the lead thread
+	 * the random engines of the workers are seeded by the random engine of the player
+	 */
+	void search_all(struct node* root, const board& state, bool ponder){
+		std::vector<worker> workers(threads);
+		for (size_t i = 0; i < workers.size(); i++) workers[i].engine.seed(engine());
+		std::vector<std::thread> pool;
+		for (size_t i = 1; i < workers.size(); i++)
+			pool.emplace_back(&player::search, this, root, std::cref(state), std::ref(workers[i]), false, ponder);
+		search(root, state, workers[0], true, ponder);
+		for (std::thread& thread : pool) thread.join();
+	}
+
+	/**
+	 * run simulations from the root until the simulation count or the time limit is reached,
+	 * the threads share the tree, the counts of simulations, and the transposition table
+	 * with the time limit, the lead thread asks the time manager whether to stop for all threads
+	 * while pondering, the simulations go on until stopped
+	 */
+	void search(struct node* root, const board& state, worker& w, bool lead, bool ponder){
+		if(ponder){
+			while(!stopped && !interrupted && total_count<ponder_count && !solution(root)){
+				insert(root,state,w);
+			}
 		}
-		while(!end){
-			bool exist_legal_move = false;
-			if(count %2 == 0 ){// my move
-				std::shuffle(space.begin(), space.end(), engine);
-				for (const action::place& move : space) {
-					if (move.apply(after) == board::legal){
-						//debug<<"count ==0 have legal move"<<std::endl;
-						win = true;
-						exist_legal_move = true;
-						count++; 
-						break;
-					}
+		else if(timer=="y"){
+			for(size_t iteration = 1; !stopped && !aborted(root); iteration++){
+				insert(root,state,w);
+				if(lead && iteration % 16 == 0 && (solution(root) || !keep_searching(root))) {
+					stopped = true;
 				}
 			}
-			else if(count %2 == 1 ) {// opponent move
-				std::shuffle(opp_space.begin(), opp_space.end(), engine);
-				for (const action::place& move : opp_space) {
-					if (move.apply(after) == board::legal){
-						//debug<<"count ==1 have legal move"<<std::endl;
-						win = false;
-						exist_legal_move = true;
-						count++; 
-						break;
-					}
+		}
+		else if(timer=="n"){
+			for(size_t iteration = 1; total_count<simulation_budget && !stopped && !aborted(root); iteration++){
+				insert(root,state,w);
+				if(lead && iteration % 16 == 0 && settled(root)) {
+					stopped = true;
 				}
 			}
-			if(!exist_legal_move) {
-				//debug<<"**********************end**********************"<<std::endl;
-				end = true;
+		}
+	}
+
+	/**
+	 * whether the search is interrupted, note that it goes on until the root has a move to play
+	 */
+	bool aborted(const struct node* root){
+		return interrupted && children(root) != 0;
+	}
+
+	/**
+	 * check the best and the second best children of the root by visits, and ask the time manager
+	 */
+	bool keep_searching(struct node* root){
+		uint32_t best_visit, second_visit;
+		struct node* best = leaders(root, best_visit, second_visit);
+		bool changed = best != last_best;
+		last_best = best;
+		return time_control.keep_searching(best_visit, second_visit, changed, total_count, choose=="visit_count");
+	}
+
+	/**
+	 * whether the move chosen by visits is settled, i.e., no other child can catch up with the best child
+	 * even if all the remaining simulations go to it, or the root has been solved
+	 */
+	bool settled(struct node* root){
+		if(solution(root)) return true;
+		if(choose!="visit_count") return false;
+		uint32_t best_visit, second_visit;
+		leaders(root, best_visit, second_visit);
+		return int(best_visit - second_visit) > simulation_budget - total_count;
+	}
+
+	/**
+	 * find the best and the second best children of the root by visits, return the best child
+	 */
+	struct node* leaders(struct node* root, uint32_t& best_visit, uint32_t& second_visit){
+		struct node* best = nullptr;
+		best_visit = second_visit = 0;
+		for(size_t i = 0 ; i<children(root); i++){
+			uint32_t visit = __atomic_load_n(&root->childs[i].child->visit_count, __ATOMIC_RELAXED);
+			if(visit>best_visit){
+				second_visit = best_visit;
+				best_visit = visit;
+				best = root->childs[i].child;
+			}
+			else if(visit>second_visit){
+				second_visit = visit;
+			}
+		}
+		return best;
+	}
+
+	/**
+	 * release all the nodes of the search at once, note that nodes may be shared by transposed positions
+	 */
+	void delete_nodes(){
+		nodes.reset();
+		table.clear();
+	}
+	/**
+	 * find the node of the state that was searched by the previous moves, and keep only
+	 * the nodes reachable from it, return nullptr if the state has not been searched
+	 * the symmetry that transforms the state into the orientation of the node is stored in symmetry
+	 *
+	 * the reachable nodes are copied into the spare arena, which then becomes the arena in use,
+	 * and the transposition table is rebuilt with the copies, whose positions are replayed along the edges
+	 */
+	struct node* reuse_node(const board& state, unsigned& symmetry){
+		struct node** found = table.find(state.canonical_hash());
+		if (!found || !orient(state, *found, symmetry)) return nullptr;
+		struct node* previous = *found;
+		std::unordered_map<node*, node*> moved;
+		std::vector<std::pair<node*, board>> pending;
+		spare.reset();
+		table.clear();
+		struct node* root = spare.create<node>(*previous);
+		moved[previous] = root;
+		pending.emplace_back(root, state);
+		pending.back().second.transform(symmetry);
+		while (pending.size()) {
+			struct node* current_node = pending.back().first;
+			board current_state = pending.back().second;
+			pending.pop_back();
+			table.insert(current_state.canonical_hash(), current_node);
+			if (current_node->childs.empty()) continue;
+			edge* childs = spare.allocate_array<edge>(current_node->moves); // leave room for the untried moves
+			for (size_t i = 0; i < current_node->childs.size(); i++) {
+				const edge& next = current_node->childs[i];
+				struct node*& child = moved[next.child];
+				if (!child) {
+					child = spare.create<node>(*next.child);
+					pending.emplace_back(child, current_state);
+					pending.back().second.place(board::point(next.move));
+					pending.back().second.transform(next.symmetry);
+				}
+				childs[i] = { child, next.move, next.symmetry, next.prior };
 			}
+			current_node->childs.first = childs;
 		}
+		nodes.swap(spare);
+		return root;
+	}
+	/**
+	 * run a random playout from the node, return whether the player wins
+	 * the moves are sampled by the weights of their patterns if the patterns are learned
+	 */
+	bool simulation(worker& w){
+		if (patterns.empty()) {
+			random_playout<board> playout(w.state);
+			return simulation(playout, w);
+		}
+		pattern_playout<board> playout(w.state, patterns);
+		return simulation(playout, w);
+	}
+	template<typename playout_type>
+	bool simulation(playout_type& playout, worker& w){
+		board::piece_type winner = playout.run(w.my_turn ? who : opp, w.engine);
+		for (unsigned c = 0; c < 2; c++) w.played[c] = playout.position().pieces(c + 1) & ~w.state.pieces(c + 1);
 		total_count++;
-		return win;
+		return winner == who;
 	}
 
-	struct node* new_node(board state){
-		struct node* current_node = new struct node;
+	/**
+	 * run a batch of random playouts from the node in lockstep, return the number of wins
+	 * with rave, the amaf statistics are updated for each lane by its own moves and result
+	 */
+	unsigned simulation_batch(worker& w){
+		playout_batch<board> playouts;
+		board::piece_type side = w.my_turn ? who : opp;
+		while (playouts.load(w.state, side));
+		playouts.run(w.engine);
+		unsigned wins = 0;
+		for (unsigned i = 0; i < playouts.size(); i++) {
+			bool win = playouts.result(i) == who;
+			wins += win ? 1 : 0;
+			if (!rave) continue;
+			for (unsigned c = 0; c < 2; c++)
+				w.played[c] = playouts.pieces(i, board::piece_type(c + 1)) & ~w.state.pieces(c + 1);
+			update_amaf(win, 1, w);
+		}
+		total_count += playouts.size();
+		return wins;
+	}
+	void simulate(worker& w){
+		struct node* leaf = w.update_nodes.back();
+		if (solution(leaf)) { // no playout is needed for a solved node
+			w.played[0] = w.played[1] = bitboard();
+			bool win = (solution(leaf) == proven_win) == w.my_turn;
+			total_count++;
+			update(win, 1, w);
+		} else if (batch) {
+			unsigned wins = simulation_batch(w);
+			update(wins, playout_batch<board>::capacity, w, false);
+		} else {
+			bool win = simulation(w);
+			update(win, 1, w);
+		}
+	}
+
+	struct node* new_node(const board& state){
+		struct node* current_node = nodes.create<node>();
 		current_node->visit_count = 0;
 		current_node->win_count = 0;
+		current_node->amaf_visits = 0;
+		current_node->amaf_wins = 0;
 		current_node->uct_value = 10000;
-		current_node->state = state;
-		// //std::cout<<state<<std::endl;
+		current_node->key = state.hash();
+		current_node->untried = state.legal_moves(state.info().who_take_turns);
+		current_node->moves = current_node->untried.count();
+		current_node->childs = {};
+		current_node->proven = current_node->moves ? unsolved : proven_loss; // no legal move, the side to move loses
 		return current_node;
 	}
 
-	void insert(struct node* root, board state){
-		// collect child
-		size_t number_of_legal_move = 0;
+	/**
+	 * get the node of the state from the transposition table, or create one if not found
+	 * symmetric positions share the same node, whose orientation is the first one being searched,
+	 * the symmetry that transforms the state into the orientation of the node is stored in symmetry
+	 */
+	struct node* find_node(const board& state, unsigned& symmetry){
+		uint64_t key = state.canonical_hash();
+		struct node** shared = table.find(key);
+		if (shared && orient(state, *shared, symmetry)) return *shared;
+		symmetry = 0;
+		struct node* current_node = new_node(state);
+		table.insert(key, current_node);
+		return current_node;
+	}
 
-		if(my_turn==true){
-			for (const action::place& move : space) {
-				board after = state;
-				if (move.apply(after) == board::legal){
-					if(root->childs.size()<=number_of_legal_move++){
-						struct node * current_node = new_node(after);		
-						root->childs.push_back(current_node);
-					}
-				}
-			}
+	/**
+	 * find the symmetry that transforms the state into the orientation of the node, by comparing the hashes
+	 */
+	static bool orient(const board& state, const struct node* current_node, unsigned& symmetry){
+		for (symmetry = 0; symmetry < board::symmetries; symmetry++) {
+			if (state.hash(symmetry) == current_node->key) return true;
 		}
-		else {
-			for (const action::place& move : opp_space) {
-				board after = state;
-				if (move.apply(after) == board::legal){
-					if(root->childs.size()<=number_of_legal_move++){
-						struct node * current_node = new_node(after);		
-						root->childs.push_back(current_node);
-					}
-				}
+		return false;
+	}
+
+	/**
+	 * expand a random untried move of the node, return nullptr if all moves have been expanded
+	 * note that the threads expand one at a time, and the new child is published only after it is filled,
+	 * so that the other threads never see a partial child
+	 */
+	struct edge* expand(struct node* root, const board& state, worker& w){
+		std::lock_guard<std::mutex> lock(expansion);
+		if(root->untried.empty()) return nullptr;
+		if(children(root)==0) root->childs.first = nodes.allocate_array<edge>(root->moves);
+		unsigned move = root->untried.select(w.engine.below(root->untried.count()));
+		unsigned side = state.info().who_take_turns;
+		if (!patterns.empty()) { // expand the move with the max weight first
+			for (bitboard rest = root->untried; rest.any(); ) {
+				unsigned i = rest.pop();
+				if (patterns.weight(state, i, side) > patterns.weight(state, move, side)) move = i;
 			}
 		}
+		root->untried.reset(move);
+		board after = state;
+		after.place(board::point(move));
+		unsigned symmetry;
+		struct edge* next = &root->childs.first[root->childs.count];
+		next->child = find_node(after, symmetry);
+		next->move = move;
+		next->symmetry = symmetry;
+		next->prior = patterns.gamma(state, move, side);
+		__atomic_store_n(&root->childs.count, root->childs.count + 1, __ATOMIC_RELEASE);
+		return next;
+	}
+	static size_t children(const struct node* root){
+		return __atomic_load_n(&root->childs.count, __ATOMIC_ACQUIRE);
+	}
+
+	/**
+	 * select the child with the max uct value, ties are broken uniformly at random
+	 * with the progressive bias, the prior of the move is added and fades out as the child is visited
+	 * the children in which the opponent provably wins are skipped, unless all children are so
+	 */
+	struct edge* select(struct node* root, worker& w){
+		int index = -1;
+		float max = -100;
+		size_t ties = 0;
+		for(size_t i = 0, n = children(root) ; i<n; i++){
+			const edge& next = root->childs[i];
+			if(solution(next.child)==proven_win) continue;
+			float value = load(next.child->uct_value);
+			if (bias) value += bias * next.prior / (__atomic_load_n(&next.child->visit_count, __ATOMIC_RELAXED) + 1);
+			if(tie_break(value, max, ties, w.engine))
+				index = i;
+		}
+		if(index==-1) index = w.engine.below(children(root)); // all moves lose, the root will be solved by update
+		return &root->childs[index];
+	}
+
+	/**
+	 * run an iteration of the search from the root, i.e., descend to a leaf while expanding an untried move
+	 * or selecting the child with the max uct value, then run a simulation from the leaf and update the path
+	 */
+	void insert(struct node* root, const board& state, worker& w){
+		struct node* current_node = root;
+		w.state = state;
+		w.my_turn = state.info().who_take_turns == who; // the opponent is to move while pondering
+		w.update_nodes.push_back(root);
+		// visit with a virtual loss, so that the other threads tend to search elsewhere until the result is updated
+		// the solved nodes are not searched further, since their results are known
+		while((visit(current_node)!=0 || current_node==root) && current_node->moves!=0 && !solution(current_node)){ // the root is always expanded
+			struct edge* next = children(current_node)<current_node->moves ? expand(current_node, w.state, w) : nullptr;
+			if(!next) next = select(current_node, w);
+			//debug<<"move :"<<int(next->move)<<std::endl;
+			w.state.place(board::point(next->move));
+			w.state.transform(next->symmetry);
+			current_node = next->child;
+			w.my_turn = !w.my_turn;
+			w.update_nodes.push_back(current_node);
+			w.update_edges.push_back(next);
+		}
 		// do simulation
-		if(root->visit_count == 0) {
-			bool win = simulation(root);
-			update(win);
+		simulate(w);
+	}
+
+	/**
+	 * count a visit of the node before its result is known, return the visit count before
+	 */
+	uint32_t visit(struct node* current_node){
+		uint32_t visit_count = __atomic_fetch_add(&current_node->visit_count, 1, __ATOMIC_RELAXED);
+		refresh(current_node, __atomic_load_n(&current_node->win_count, __ATOMIC_RELAXED), visit_count + 1);
+		return visit_count;
+	}
+
+	/**
+	 * return whether value should replace the current max, which is chosen uniformly from the ties
+	 */
+	template<typename engine_type>
+	static bool tie_break(float value, float& max, size_t& ties, engine_type& engine){
+		if(value>max){
+			max = value;
+			ties = 1;
+			return true;
 		}
-		else {
-			int index = -1;
-			float max=-100;
-			size_t child_visit_count = 0;
-			bool do_expand = true;
-			//get number of child have been visited
-			for(size_t i = 0 ; i<root->childs.size(); i++) {
-				if(root->childs[i]->visit_count!=0)
-					child_visit_count++;
-			}
-			// check need expand or not
-			if(child_visit_count == number_of_legal_move) do_expand = false;
-			//debug<<"child_visit_count"<<child_visit_count<<", number_of_legal_move"<<number_of_legal_move<<std::endl;
-			if(number_of_legal_move==0){
-				bool win = simulation(root);
-				update(win);
-				return;
-			} 
+		return value==max && std::uniform_int_distribution<size_t>(0, ties++)(engine) == 0;
+	}
 
-			if(do_expand){
-				std::shuffle(root->childs.begin(), root->childs.end(), engine);
+	/**
+	 * with rave, the win rate is blended with the amaf win rate by beta = sqrt(k / (3 * visit_count + k)),
+	 * so that the amaf statistics dominate when there are few visits
+	 */
+	float UCT_value(float win_count, float visit_count, float amaf_wins = 0, float amaf_visits = 0){
+		float win_rate = win_count/visit_count;
+		if (rave && amaf_visits > 0) {
+			float beta = std::sqrt(rave_k / (3 * visit_count + rave_k));
+			win_rate = (1 - beta) * win_rate + beta * amaf_wins / amaf_visits;
+		}
+		return  win_rate + weight * log(float(total_count)) / visit_count ;
+	}
 
-				for(size_t i = 0 ; i<root->childs.size(); i++){
-					if(root->childs[i]->uct_value>max && root->childs[i]->visit_count==0){
-						max = root->childs[i]->uct_value;
-						index = i;
-					}
-				}
-				//debug<<"expand index :"<<index<<std::endl;
-			}else{
-				for(size_t i = 0 ; i<root->childs.size(); i++){
-					if(root->childs[i]->uct_value>max){
-						max = root->childs[i]->uct_value;
-						index = i;
-					}
-				}
-				//debug<<"select index:"<<index<<std::endl;
+	/**
+	 * recompute the uct value of the node with the given counts and its amaf counts
+	 */
+	void refresh(struct node* current_node, uint32_t win_count, uint32_t visit_count){
+		uint32_t amaf_visits = __atomic_load_n(&current_node->amaf_visits, __ATOMIC_RELAXED);
+		uint32_t amaf_wins = __atomic_load_n(&current_node->amaf_wins, __ATOMIC_RELAXED);
+		store(current_node->uct_value, UCT_value(win_count, visit_count, amaf_wins, amaf_visits));
+	}
+
+	/**
+	 * add the results of the playouts to the nodes along the path, wins is the number of won playouts
+	 * note that each node has already counted one visit as a virtual loss
+	 * the amaf statistics are updated by the moves in w.played unless amaf is false, e.g., by simulation_batch
+	 */
+	void update(uint32_t wins, uint32_t visits, worker& w, bool amaf = true){
+		//debug<<w.update_nodes.size()<<std::endl;
+		//debug<<"wins = "<<wins<<std::endl;
+		for (size_t i = 0 ; i< w.update_nodes.size() ; i++){
+			uint32_t visit_count = __atomic_add_fetch(&w.update_nodes[i]->visit_count, visits - 1, __ATOMIC_RELAXED);
+			uint32_t win_count = __atomic_add_fetch(&w.update_nodes[i]->win_count, wins, __ATOMIC_RELAXED);
+			refresh(w.update_nodes[i], win_count, visit_count);
+		}
+		if (rave && amaf) update_amaf(wins, visits, w);
+		// solve the nodes along the path upwards, as long as the node below has been solved
+		for (size_t i = w.update_nodes.size() - 1; i > 0 && solution(w.update_nodes[i]); i--) solve(w.update_nodes[i - 1]);
+		// clear update_nodes
+		w.update_nodes.clear();
+		w.update_edges.clear();
+	}
+
+	/**
+	 * try to solve the node by its children, i.e., the side to move wins if any child is a loss
+	 * for the opponent, or loses if it is fully expanded and all children are wins for the opponent
+	 */
+	void solve(struct node* current_node){
+		if (solution(current_node)) return;
+		size_t n = children(current_node);
+		bool lost = n == current_node->moves;
+		for (size_t i = 0; i < n; i++) {
+			uint8_t result = solution(current_node->childs[i].child);
+			if (result == proven_loss) {
+				__atomic_store_n(&current_node->proven, uint8_t(proven_win), __ATOMIC_RELAXED);
+				return;
 			}
-			my_turn = !my_turn;
-			update_nodes.push_back(root->childs[index]);
-			insert(root->childs[index],root->childs[index]->state);
+			lost &= result == proven_win;
 		}
+		if (lost) __atomic_store_n(&current_node->proven, uint8_t(proven_loss), __ATOMIC_RELAXED);
+	}
+	static uint8_t solution(const struct node* current_node){
+		return __atomic_load_n(&current_node->proven, __ATOMIC_RELAXED);
 	}
 
-	float UCT_value(float win_count, float visit_count){
-		return  win_count/visit_count + weight * log(total_count) / visit_count ;
+	/**
+	 * whether the move should be avoided since it provably loses, unless all moves lose (hopeless)
+	 */
+	static bool losing(const edge& next, bool hopeless){
+		return !hopeless && solution(next.child) == proven_win;
 	}
 
-	void update(bool win){
-		//debug<<update_nodes.size()<<std::endl;
-		float value = 0;
-		if(win) value = 1;
-		//debug<<"win = "<<win<<std::endl;
-		for (size_t i = 0 ; i< update_nodes.size() ; i++){
-			update_nodes[i]->visit_count++;
-			update_nodes[i]->win_count += value;	
-			update_nodes[i]->uct_value = UCT_value(update_nodes[i]->win_count, update_nodes[i]->visit_count);
+	/**
+	 * update the all-moves-as-first statistics, i.e., for each node on the path, credit its children
+	 * whose moves were played later by the same side, either in the tree or in the playout
+	 * note that the children are shared by symmetric positions, so the amaf counts are kept in the child nodes
+	 */
+	void update_amaf(uint32_t wins, uint32_t visits, worker& w){
+		bitboard played[2] = { w.played[0], w.played[1] };
+		for (size_t i = w.update_edges.size(); i-- > 0; ) {
+			const edge* next = w.update_edges[i];
+			for (bitboard& moves : played) moves = board::untransform(moves, next->symmetry);
+			bool mine = w.my_turn == ((w.update_edges.size() - i) % 2 == 0); // whether the move is played by the player
+			bitboard& own = played[(mine ? who : opp) - 1];
+			own.set(next->move);
+			struct node* current_node = w.update_nodes[i];
+			for (size_t j = 0, n = children(current_node); j < n; j++) {
+				struct node* child = current_node->childs[j].child;
+				if (!own.test(current_node->childs[j].move)) continue;
+				__atomic_add_fetch(&child->amaf_visits, visits, __ATOMIC_RELAXED);
+				__atomic_add_fetch(&child->amaf_wins, wins, __ATOMIC_RELAXED);
+				refresh(child, __atomic_load_n(&child->win_count, __ATOMIC_RELAXED), __atomic_load_n(&child->visit_count, __ATOMIC_RELAXED));
+			}
 		}
-		// clear total_count and update_nodes
-		update_nodes.clear();
 	}
-	float total_count = 0 ;
-	std::vector<node*> update_nodes;
-	bool my_turn;
+
+	/**
+	 * atomic access to the uct values of the nodes, which are shared by the threads,
+	 * note that the counters are accessed by the atomic builtins directly
+	 */
+	static float load(const float& x){
+		float value;
+		__atomic_load(&x, &value, __ATOMIC_RELAXED);
+		return value;
+	}
+	static void store(float& x, float value){
+		__atomic_store(&x, &value, __ATOMIC_RELAXED);
+	}
+
+	std::atomic<int> total_count{0};
+	std::atomic<bool> stopped{false}; // whether the threads should stop searching
+	std::atomic<bool> interrupted{false}; // whether the search is aborted, see interrupt
 private:
 	// int simulation_count = stoi(property("N"));
 	// float weight = stof(property("c"));
 	// std::string timer = property("timer");
 	// std::string choose = property("choose");
 	int simulation_count;
+	int simulation_budget; // the simulation count of this move including the banked simulations, see take_action
+	int banked = 0; // the simulations saved by the previous moves with timer=n
 	float weight;
 	std::string choose;
 	std::string timer;
-	std::vector<action::place> space;
-	std::vector<action::place> opp_space;
+	bool batch; // whether to run the playouts in batches, see playout_batch
+	bool reuse; // whether to keep the searched nodes for the next moves, see reuse_node
+	int threads; // the number of search threads
+	bool rave; // whether to blend the amaf statistics into the uct values, see update_amaf
+	float rave_k; // the number of visits at which the amaf statistics weigh about a half
+	int ponder_count; // the max number of simulations while pondering
+	float bias; // the weight of the progressive bias by the priors of the moves
+	std::mutex expansion; // held while creating nodes, see expand
 	board::piece_type who;
+	board::piece_type opp;
+	transposition_table<node*> table; // the nodes of the search, indexed by the canonical hash of their positions
+	arena nodes; // all the nodes of the search and their child lists
+	arena spare; // the arena for moving the reused nodes into
+	pattern_table<board> patterns; // the weights of the patterns for the playouts and the priors, see pattern_table
+	time_manager time_control; // the thinking time of each move with timer=y
+	struct node* last_best = nullptr; // the best child of the root at the last check of the time
+	std::thread pondering; // the background search, see ponder
+	std::mutex background; // held while starting or stopping the background search
 };
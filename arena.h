@@ -0,0 +1,127 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * arena.h: Bump allocator for objects that are released all at once
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <sys/mman.h>
+
+/**
+ * an arena hands out memory from a list of contiguous slabs by bumping an offset,
+ * and releases everything at once by rewinding to the first slab, so the slabs are reused
+ * objects in the arena are never destructed, i.e., they should be trivially destructible
+ *
+ * with huge pages, slabs are aligned to 2MB and advised to be backed by transparent huge pages,
+ * which reduces TLB misses when walking a large tree
+ */
+class arena {
+public:
+	static constexpr size_t huge_page = 2 << 20;
+
+	arena(size_t slab_size = huge_page, bool huge = false) :
+		slab_size(huge ? (slab_size + huge_page - 1) / huge_page * huge_page : slab_size),
+		huge(huge), current(0), offset(0) {}
+	arena(const arena&) = delete;
+	arena& operator =(const arena&) = delete;
+	~arena() { for (char* slab : slabs) std::free(slab); }
+
+public:
+	/**
+	 * allocate uninitialized memory from the current slab, or move on to the next slab if it is full
+	 */
+	void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+		if (size > slab_size) throw std::bad_alloc();
+		offset = (offset + align - 1) & ~(align - 1);
+		if (current == slabs.size() || offset + size > slab_size) {
+			if (current < slabs.size()) current++;
+			if (current == slabs.size()) slabs.push_back(new_slab());
+			offset = 0;
+		}
+		void* p = slabs[current] + offset;
+		offset += size;
+		return p;
+	}
+
+	/**
+	 * construct an object in the arena
+	 */
+	template<typename type, typename... args_type>
+	type* create(args_type&&... args) {
+		static_assert(std::is_trivially_destructible<type>::value, "objects in an arena are never destructed");
+		return new (allocate(sizeof(type), alignof(type))) type(std::forward<args_type>(args)...);
+	}
+
+	/**
+	 * allocate an uninitialized array in the arena
+	 */
+	template<typename type>
+	type* allocate_array(size_t n) {
+		static_assert(std::is_trivially_destructible<type>::value, "objects in an arena are never destructed");
+		return static_cast<type*>(allocate(n * sizeof(type), alignof(type)));
+	}
+
+	/**
+	 * release all the objects in O(1), the slabs are kept for later allocations
+	 */
+	void reset() { current = 0; offset = 0; }
+
+	/**
+	 * exchange the slabs and the objects with another arena
+	 */
+	void swap(arena& a) {
+		std::swap(slab_size, a.slab_size);
+		std::swap(huge, a.huge);
+		slabs.swap(a.slabs);
+		std::swap(current, a.current);
+		std::swap(offset, a.offset);
+	}
+
+	/**
+	 * the number of bytes in use, including the unused tails of the filled slabs
+	 */
+	size_t size() const { return current * slab_size + offset; }
+	size_t capacity() const { return slabs.size() * slab_size; }
+
+private:
+	char* new_slab() {
+		void* space = nullptr;
+		if (posix_memalign(&space, huge ? huge_page : 64, slab_size) != 0) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+		if (huge) madvise(space, slab_size, MADV_HUGEPAGE);
+#endif
+		return static_cast<char*>(space);
+	}
+
+private:
+	size_t slab_size;
+	bool huge;
+	std::vector<char*> slabs;
+	size_t current; // the index of the slab in use
+	size_t offset; // the number of bytes used in the current slab
+};
+
+/**
+ * a fixed-size array allocated in an arena, which is trivially destructible
+ */
+template<typename type>
+struct arena_array {
+	type* first;
+	uint32_t count;
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	type* begin() const { return first; }
+	type* end() const { return first + count; }
+	type& operator [](size_t i) const { return first[i]; }
+};
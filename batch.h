@@ -0,0 +1,242 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * batch.h: Random playouts of several independent games in lockstep with SIMD
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include "bitboard.h"
+#include "board.h"
+
+/**
+ * a vector of n 64-bit words, one word for each lane
+ */
+template<unsigned n>
+struct lane_vector {
+	typedef uint64_t type __attribute__((vector_size(n * sizeof(uint64_t))));
+};
+
+/**
+ * the default number of lanes, so that a vector of the lanes fits in one register, e.g., -DPLAYOUT_LANES=8 to override
+ */
+#ifndef PLAYOUT_LANES
+#ifdef __AVX2__
+#define PLAYOUT_LANES 4
+#else
+#define PLAYOUT_LANES 2
+#endif
+#endif
+
+/**
+ * plays random games of several lanes in lockstep
+ *
+ * the boards of all lanes are bit-sliced, i.e., the low and high words of a bitboard
+ * are stored as two vectors with one element per lane, so that the dilations for checking
+ * the legality of the moves of all lanes are done at once (with SSE2 by default, or AVX2 if enabled)
+ * wider batches than a register are slower, since the floods of all lanes go on until the longest one ends
+ *
+ * each lane keeps the candidate moves of both sides in lists, which are initialized by board::legal_moves,
+ * as random_playout does, so that a random candidate is picked in constant time
+ * in each step, every lane picks a random candidate of the side to move, and then the candidates
+ * of all lanes are checked together; a lane plays its candidate if it is legal, or drops it otherwise,
+ * since a move which becomes illegal in NoGo will never be legal again
+ * a lane finishes once the side to move runs out of candidates, i.e., the side loses
+ */
+template<typename board_type, unsigned lanes = PLAYOUT_LANES>
+class playout_batch {
+public:
+	typedef typename lane_vector<lanes>::type word;
+	typedef typename board_type::piece_type piece_type;
+	static constexpr unsigned capacity = lanes;
+	enum { area = board_type::size_x * board_type::size_y, none = 0xff };
+
+	/**
+	 * a bitboard of all lanes
+	 */
+	struct slice {
+		word lo, hi;
+		slice operator &(const slice& s) const { return { lo & s.lo, hi & s.hi }; }
+		slice operator |(const slice& s) const { return { lo | s.lo, hi | s.hi }; }
+		slice operator ~() const { return { ~lo, ~hi }; }
+		slice operator <<(unsigned n) const { return { lo << n, (hi << n) | (lo >> (64 - n)) }; }
+		slice operator >>(unsigned n) const { return { (lo >> n) | (hi << (64 - n)), hi >> n }; }
+		slice nonzero() const { word m = (word)((lo | hi) != 0); return { m, m }; } // all ones for each non-empty lane
+		slice several() const { // all ones for each lane with more than one position
+			word m = (word)(((lo & (lo - 1)) | (hi & (hi - 1))) != 0) | (word)((lo != 0) & (hi != 0));
+			return { m, m };
+		}
+		bitboard at(unsigned l) const { return bitboard(lo[l], hi[l]); }
+		void set(unsigned l, const bitboard& b) { lo[l] = b.lo; hi[l] = b.hi; }
+		static slice broadcast(const bitboard& b) {
+			slice s;
+			for (unsigned l = 0; l < lanes; l++) s.set(l, b);
+			return s;
+		}
+	};
+
+public:
+	playout_batch() : self(), other(), turn(), winner(), used(0) {
+		board_mask = slice::broadcast(board_type::geometry::board_mask);
+		space_mask = slice::broadcast(board_type::geometry::space_mask);
+		bottom_mask = slice::broadcast(board_type::geometry::bottom_mask);
+		top_mask = slice::broadcast(board_type::geometry::top_mask);
+	}
+
+	/**
+	 * set up the next lane with the state and the side to move, return false if all lanes are used
+	 */
+	bool load(const board_type& state, piece_type who) {
+		if (used == lanes) return false;
+		unsigned l = used++;
+		turn[l] = who;
+		winner[l] = board_type::empty;
+		self.set(l, state.pieces(who));
+		other.set(l, state.pieces(3u - who));
+		for (unsigned c = 0; c < 2; c++) {
+			length[c][l] = 0;
+			std::fill(where[c][l], where[c][l] + area, uint8_t(none));
+			for (bitboard moves = state.legal_moves(c + 1); moves.any(); ) {
+				unsigned i = moves.pop();
+				where[c][l][i] = length[c][l];
+				list[c][l][length[c][l]++] = i;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * play all the loaded lanes until the end, the engine should provide below(n) as xoshiro256 does
+	 */
+	template<typename engine_type>
+	void run(engine_type& engine) {
+		std::array<unsigned, lanes> move;
+		for (bool ongoing = true; ongoing; ) {
+			slice put = {};
+			ongoing = false;
+			for (unsigned l = 0; l < used; l++) {
+				move[l] = none;
+				if (winner[l] != board_type::empty) continue;
+				unsigned c = turn[l] - 1;
+				if (length[c][l] == 0) {
+					winner[l] = static_cast<piece_type>(3u - turn[l]);
+					continue;
+				}
+				move[l] = list[c][l][engine.below(length[c][l])];
+				put.set(l, bitboard::bit(move[l]));
+				ongoing = true;
+			}
+			if (!ongoing) break;
+
+			slice legal = check(put);
+			for (unsigned l = 0; l < used; l++) {
+				if (move[l] == none) continue;
+				if (legal.lo[l]) {
+					drop(0, l, move[l]);
+					drop(1, l, move[l]);
+					turn[l] = static_cast<piece_type>(3u - turn[l]);
+				} else {
+					drop(turn[l] - 1, l, move[l]);
+				}
+			}
+			slice next = self | (put & legal); // swap the sides of the lanes which played their moves
+			self = (other & legal) | (self & ~legal);
+			other = (next & legal) | (other & ~legal);
+		}
+	}
+
+	/**
+	 * the winner of the lane, or piece_type::empty if the lane has not finished
+	 */
+	piece_type result(unsigned l) const { return winner[l]; }
+
+	/**
+	 * the stones of the lane (l) of who, e.g., to find the moves played in the lane
+	 */
+	bitboard pieces(unsigned l, piece_type who) const { return (who == turn[l] ? self : other).at(l); }
+	unsigned size() const { return used; }
+	void clear() { used = 0; }
+
+protected:
+	/**
+	 * remove the candidate (i) of side (c) of lane (l), if it is still a candidate
+	 */
+	void drop(unsigned c, unsigned l, unsigned i) {
+		unsigned k = where[c][l][i];
+		if (k == none) return;
+		unsigned last = list[c][l][--length[c][l]];
+		list[c][l][k] = last;
+		where[c][l][last] = k;
+		where[c][l][i] = none;
+	}
+
+	/**
+	 * check the candidates of all lanes at once, return all ones for each lane whose candidate is legal
+	 */
+	slice check(const slice& put) const {
+		slice own = self | put;
+		slice space = space_mask & ~(own | other);
+		// a block is flooded only in the lanes where the stone itself has no liberty, so most floods end at once
+		slice free = (adjacent(put) & space).nonzero();
+		slice mine = put & ~free;
+		slice threat = other & ~adjacent(space); // the opponent stones without a liberty next to them
+		slice foes = adjacent(put) & threat;
+		// the neighboring opponent stones of a lane are flooded together if there is only one of them,
+		// and the rare lanes with several of them are checked block by block below
+		slice several = foes.several();
+		slice group = foes & ~several;
+		flood(mine, own, group, other);
+		slice legal = put.nonzero() & (free | (adjacent(mine) & space).nonzero()); // not suicide
+		legal = legal & ~(group.nonzero() & ~(adjacent(group) & space).nonzero()); // and not capturing
+		if (!any(several)) return legal;
+		slice cut = several & threat;
+		slice block[] = { (put << board_type::size_y) & cut, (put >> board_type::size_y) & cut,
+		                  ((put & ~top_mask) << 1) & cut, ((put & ~bottom_mask) >> 1) & cut };
+		flood(block[0], other, block[1], other);
+		flood(block[2], other, block[3], other);
+		for (const slice& b : block) legal = legal & ~(b.nonzero() & ~(adjacent(b) & space).nonzero());
+		return legal;
+	}
+
+	slice adjacent(const slice& m) const {
+		slice near = (m << board_type::size_y) | (m >> board_type::size_y);
+		near = near | ((m & ~top_mask) << 1) | ((m & ~bottom_mask) >> 1);
+		return near & board_mask;
+	}
+
+	/**
+	 * grow the blocks a within mask_a and b within mask_b at the same time, until neither changes
+	 */
+	void flood(slice& a, const slice& mask_a, slice& b, const slice& mask_b) const {
+		if (!any(a | b)) return;
+		while (true) {
+			slice grow_a = (a | adjacent(a)) & mask_a, grow_b = (b | adjacent(b)) & mask_b;
+			if (!any({ (grow_a.lo ^ a.lo) | (grow_b.lo ^ b.lo), (grow_a.hi ^ a.hi) | (grow_b.hi ^ b.hi) })) return;
+			a = grow_a;
+			b = grow_b;
+		}
+	}
+
+	static bool any(const slice& m) {
+		word bits = m.lo | m.hi;
+		uint64_t fold = 0;
+		for (unsigned l = 0; l < lanes; l++) fold |= bits[l];
+		return fold != 0;
+	}
+
+private:
+	slice self; // the stones of the side to move of each lane
+	slice other; // the stones of the other side of each lane
+	slice board_mask, space_mask, bottom_mask, top_mask;
+	uint8_t list[2][lanes][area]; // the candidate moves of black and white of each lane
+	uint8_t where[2][lanes][area]; // the index of each position in the list, or none
+	uint8_t length[2][lanes]; // the number of the candidates
+	std::array<piece_type, lanes> turn;
+	std::array<piece_type, lanes> winner;
+	unsigned used;
+};
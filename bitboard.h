@@ -0,0 +1,109 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * bitboard.h: Define the 128-bit mask used to represent a set of board positions
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+
+/**
+ * a set of up to 128 positions, stored as two 64-bit words
+ * bit (i) of the mask represents the position (i) in 1-d array style,
+ * i.e., bits 0 ~ 63 are stored in lo, and bits 64 ~ 127 are stored in hi
+ */
+class bitboard {
+public:
+	constexpr bitboard(uint64_t lo = 0, uint64_t hi = 0) : lo(lo), hi(hi) {}
+	bitboard(const bitboard& b) = default;
+	bitboard& operator =(const bitboard& b) = default;
+
+	/**
+	 * create a mask with only bit (i) set
+	 */
+	static constexpr bitboard bit(unsigned i) {
+		return i < 64 ? bitboard(1ull << i, 0) : bitboard(0, 1ull << (i - 64));
+	}
+
+public:
+	constexpr bitboard operator &(const bitboard& b) const { return bitboard(lo & b.lo, hi & b.hi); }
+	constexpr bitboard operator |(const bitboard& b) const { return bitboard(lo | b.lo, hi | b.hi); }
+	constexpr bitboard operator ^(const bitboard& b) const { return bitboard(lo ^ b.lo, hi ^ b.hi); }
+	constexpr bitboard operator ~() const { return bitboard(~lo, ~hi); }
+	bitboard& operator &=(const bitboard& b) { lo &= b.lo; hi &= b.hi; return *this; }
+	bitboard& operator |=(const bitboard& b) { lo |= b.lo; hi |= b.hi; return *this; }
+	bitboard& operator ^=(const bitboard& b) { lo ^= b.lo; hi ^= b.hi; return *this; }
+
+	/**
+	 * shift the whole 128-bit mask, note that n should be in range [0, 64)
+	 */
+	constexpr bitboard operator <<(unsigned n) const {
+		return n ? bitboard(lo << n, (hi << n) | (lo >> (64 - n))) : *this;
+	}
+	constexpr bitboard operator >>(unsigned n) const {
+		return n ? bitboard((lo >> n) | (hi << (64 - n)), hi >> n) : *this;
+	}
+
+	constexpr bool operator ==(const bitboard& b) const { return lo == b.lo && hi == b.hi; }
+	constexpr bool operator !=(const bitboard& b) const { return !(*this == b); }
+	constexpr bool operator < (const bitboard& b) const { return hi != b.hi ? hi < b.hi : lo < b.lo; }
+
+public:
+	constexpr bool empty() const { return (lo | hi) == 0; }
+	constexpr bool any() const { return !empty(); }
+	constexpr bool test(unsigned i) const { return !(*this & bit(i)).empty(); }
+	void set(unsigned i) { *this |= bit(i); }
+	void reset(unsigned i) { *this &= ~bit(i); }
+
+	/**
+	 * the number of positions in this set
+	 */
+	unsigned count() const { return __builtin_popcountll(lo) + __builtin_popcountll(hi); }
+
+	/**
+	 * the lowest position in this set, the set should not be empty
+	 */
+	unsigned first() const { return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll(hi); }
+
+	/**
+	 * the (k)-th lowest position in this set, note that k should be less than count()
+	 */
+	unsigned select(unsigned k) const {
+		unsigned n = __builtin_popcountll(lo), base = 0;
+		uint64_t word = lo;
+		if (k >= n) {
+			k -= n;
+			word = hi;
+			base = 64;
+		}
+		for (; k; k--) word &= word - 1;
+		return base + __builtin_ctzll(word);
+	}
+
+	/**
+	 * remove and return the lowest position in this set, the set should not be empty
+	 */
+	unsigned pop() {
+		unsigned i = first();
+		if (lo) lo &= lo - 1;
+		else    hi &= hi - 1;
+		return i;
+	}
+
+public:
+	friend std::ostream& operator <<(std::ostream& out, const bitboard& b) {
+		std::ios ff(nullptr);
+		ff.copyfmt(out); // make a copy of the original print format
+		out << std::hex << std::setfill('0') << std::setw(16) << b.hi << std::setw(16) << b.lo;
+		out.copyfmt(ff); // restore print format
+		return out;
+	}
+
+public:
+	uint64_t lo, hi;
+};
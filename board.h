@@ -15,6 +15,8 @@
 #include <algorithm>
 #include <utility>
 #include <cmath>
+#include "bitboard.h"
+#include "geometry.h"
 
 /**
  * definition for the 9x9 board
@@ -41,11 +43,30 @@
  *
  * for 9x9 Hollow NoGo, the center 3x3 is hollow (hollow but not empty, cannot be counted as liberty),
  * i.e., there are also borders at the center of the board
+ *
+ * the position is stored as one bitboard per color, indexed by 1-d array style,
+ * the hollow and the border of the board are described by constant masks,
+ * blocks and liberties are calculated by iterated shift-and-mask dilation
+ *
+ * the blocks are also maintained incrementally, each stone records the root of its block,
+ * and each root records the number of liberties of its block, so that checking only looks up the neighbors
+ * note that stones are never removed in NoGo, i.e., blocks are only merged and liberties are only reduced
+ *
+ * a 64-bit zobrist hash of the stones is maintained as well, which identifies the position for searching
+ * the board is invariant under the dihedral symmetries (8 for square boards, otherwise 4),
+ * so the hash of each symmetric position is also maintained, and the minimum one is the canonical hash
+ *
+ * the size of the board and the hollow are template parameters, and all the masks and tables
+ * are generated at compile time (see geometry.h), e.g., basic_board<9, 9, 3, 3> is the board above,
+ * basic_board<11, 11, 3, 3> is 11x11 Hollow NoGo, and basic_board<7, 7, 0, 0> is 7x7 NoGo without hollow
  */
-class board {
+template<unsigned width, unsigned height, unsigned hollow_width, unsigned hollow_height>
+class basic_board {
 public:
-	enum size { size_x = 9u, size_y = 9u, hollow_x = 3u, hollow_y = 3u };
+	enum size { size_x = width, size_y = height, hollow_x = hollow_width, hollow_y = hollow_height };
 	enum piece_type { empty = 0u, black = 1u, white = 2u, hollow = 3u, unknown = -1u };
+	typedef board_geometry<width, height, hollow_width, hollow_height> geometry;
+	enum symmetry_type { symmetries = geometry::symmetries };
 	typedef uint32_t cell;
 	typedef std::array<cell, size_y> column;
 	typedef std::array<column, size_x> grid;
@@ -55,10 +76,13 @@ public:
 	typedef int reward;
 
 public:
-	board() : stone(initial()), attr({piece_type::black}) {}
-	board(const grid& b, const data& d) : stone(b), attr(d) {}
-	board(const board& b) = default;
-	board& operator =(const board& b) = default;
+	basic_board() : stone(), chain(), liberty(), zobrist(), attr({piece_type::black}) {}
+	basic_board(const grid& b, const data& d) : stone(), chain(), liberty(), zobrist(), attr(d) {
+		for (int i = 0; i < size_x * size_y; i++) put(i, b[i / size_y][i % size_y]);
+		rebuild();
+	}
+	basic_board(const basic_board& b) = default;
+	basic_board& operator =(const basic_board& b) = default;
 
 	struct point {
 		int x, y, i;
@@ -76,25 +100,126 @@ public:
 		}
 	};
 
-	operator grid&() { return stone; }
-	operator const grid&() const { return stone; }
-	column& operator [](unsigned x) { return stone[x]; }
-	const column& operator [](unsigned x) const { return stone[x]; }
-	cell& operator ()(unsigned i) { point p(i); return stone[p.x][p.y]; }
-	const cell& operator ()(unsigned i) const { point p(i); return stone[p.x][p.y]; }
-	cell& operator ()(const std::string& move) { point p(move); return stone[p.x][p.y]; }
-	const cell& operator ()(const std::string& move) const { point p(move); return stone[p.x][p.y]; }
+	/**
+	 * proxies for accessing a cell as if the board were stored as a grid
+	 */
+	class reference {
+	public:
+		reference(basic_board& b, unsigned i) : b(b), i(i) {}
+		operator cell() const { return b.at(i); }
+		reference& operator =(cell type) { b.set(i, type); return *this; }
+		reference& operator =(const reference& r) { return operator =(cell(r)); }
+	private:
+		basic_board& b;
+		unsigned i;
+	};
+	class column_reference {
+	public:
+		column_reference(basic_board& b, unsigned x) : b(b), x(x) {}
+		reference operator [](unsigned y) const { return reference(b, x * size_y + y); }
+	private:
+		basic_board& b;
+		unsigned x;
+	};
+	class const_column_reference {
+	public:
+		const_column_reference(const basic_board& b, unsigned x) : b(b), x(x) {}
+		cell operator [](unsigned y) const { return b.at(x * size_y + y); }
+	private:
+		const basic_board& b;
+		unsigned x;
+	};
+
+	operator grid() const {
+		grid g;
+		for (int i = 0; i < size_x * size_y; i++) g[i / size_y][i % size_y] = at(i);
+		return g;
+	}
+	column_reference operator [](unsigned x) { return column_reference(*this, x); }
+	const_column_reference operator [](unsigned x) const { return const_column_reference(*this, x); }
+	reference operator ()(unsigned i) { return reference(*this, i); }
+	cell operator ()(unsigned i) const { return at(i); }
+	reference operator ()(const std::string& move) { return reference(*this, point(move).i); }
+	cell operator ()(const std::string& move) const { return at(point(move).i); }
 
 	data info() const { return attr; }
 	data info(data dat) { data old = attr; attr = dat; return old; }
 
+	/**
+	 * the zobrist hash of the stones, note that the side to move is not included
+	 * hash(s) is the hash of the position transformed by symmetry (s), see board_shape::transform for details
+	 */
+	uint64_t hash(unsigned s = 0) const { return zobrist[s]; }
+
+	/**
+	 * the hash shared by all the symmetric positions
+	 */
+	uint64_t canonical_hash() const {
+		return *std::min_element(zobrist.begin(), zobrist.begin() + symmetries);
+	}
+
+	/**
+	 * find the symmetry (s) that maps the stones of this board to the stones of b, see board_shape::transform
+	 * return -1 if b is not symmetric to this board
+	 */
+	int symmetry_to(const basic_board& b) const {
+		if (stone[0].count() != b.stone[0].count() || stone[1].count() != b.stone[1].count()) return -1;
+		for (unsigned s = 0; s < symmetries; s++) {
+			if (zobrist[s] != b.zobrist[0]) continue;
+			bool same = true;
+			for (unsigned who = 0; who < 2 && same; who++) {
+				for (bitboard rest = stone[who]; rest.any() && same; same = b.stone[who].test(geometry::symmetry[s][rest.pop()]));
+			}
+			if (same) return s;
+		}
+		return -1;
+	}
+
+	/**
+	 * check whether the stones of b are the same as the stones of this board under some symmetry
+	 */
+	bool symmetric_to(const basic_board& b) const { return symmetry_to(b) != -1; }
+
 public:
-	bool operator ==(const board& b) const { return stone == b.stone; }
-	bool operator < (const board& b) const { return stone <  b.stone; }
-	bool operator !=(const board& b) const { return !(*this == b); }
-	bool operator > (const board& b) const { return b < *this; }
-	bool operator <=(const board& b) const { return !(b < *this); }
-	bool operator >=(const board& b) const { return !(*this < b); }
+	/**
+	 * get the piece type at the position (i)
+	 */
+	cell at(unsigned i) const {
+		if (stone[0].test(i)) return piece_type::black;
+		if (stone[1].test(i)) return piece_type::white;
+		if (hollow_mask().test(i)) return piece_type::hollow;
+		return piece_type::empty;
+	}
+
+	/**
+	 * overwrite the piece type at the position (i) without checking the rules
+	 * note that the hollow is fixed, i.e., setting or clearing the hollow is ignored
+	 */
+	void set(unsigned i, cell type) {
+		put(i, type);
+		rebuild();
+	}
+
+	/**
+	 * get the positions occupied by the given piece type
+	 */
+	bitboard pieces(unsigned who) const {
+		switch (who) {
+		case piece_type::empty:  return space_mask() & ~(stone[0] | stone[1]);
+		case piece_type::black:  return stone[0];
+		case piece_type::white:  return stone[1];
+		case piece_type::hollow: return hollow_mask();
+		default:                 return {};
+		}
+	}
+
+public:
+	bool operator ==(const basic_board& b) const { return stone[0] == b.stone[0] && stone[1] == b.stone[1]; }
+	bool operator < (const basic_board& b) const { return stone[0] != b.stone[0] ? stone[0] < b.stone[0] : stone[1] < b.stone[1]; }
+	bool operator !=(const basic_board& b) const { return !(*this == b); }
+	bool operator > (const basic_board& b) const { return b < *this; }
+	bool operator <=(const basic_board& b) const { return !(b < *this); }
+	bool operator >=(const basic_board& b) const { return !(*this < b); }
 
 public:
 	enum nogo_move_result {
@@ -108,27 +233,63 @@ public:
 	};
 
 	/**
-	 * place a stone to the specific position
+	 * check whether placing a stone to the specific position is legal, the board is not modified
 	 * who == piece_type::unknown indicates automatically play as the next side
 	 * return nogo_move_result::legal if the action is valid, or nogo_move_result::illegal_* if not
 	 */
-	reward place(int x, int y, unsigned who = piece_type::unknown) {
+	reward check_move(int x, int y, unsigned who = piece_type::unknown) const {
 		if (who == -1u) who = attr.who_take_turns;
 		if (who != attr.who_take_turns) return nogo_move_result::illegal_turn;
 		if (x == -1 && y == -1) return nogo_move_result::illegal_pass;
-		point p_min(0, 0), p_max(size_x - 1, size_y - 1);
-		if (x < p_min.x || x > p_max.x || y < p_min.y || y > p_max.y) return nogo_move_result::illegal_out_of_range;
-		if (board::initial()[x][y] == piece_type::hollow)             return nogo_move_result::illegal_out_of_range;
-		board test = *this;
-		if (test[x][y] != piece_type::empty) return nogo_move_result::illegal_not_empty;
-		test[x][y] = who; // try put a piece first
-		if (test.check_liberty(x, y, who) == 0) return nogo_move_result::illegal_suicide;
-		unsigned opp = 3u - who;
-		if (x > p_min.x && test.check_liberty(x - 1, y, opp) == 0) return nogo_move_result::illegal_take;
-		if (x < p_max.x && test.check_liberty(x + 1, y, opp) == 0) return nogo_move_result::illegal_take;
-		if (y > p_min.y && test.check_liberty(x, y - 1, opp) == 0) return nogo_move_result::illegal_take;
-		if (y < p_max.y && test.check_liberty(x, y + 1, opp) == 0) return nogo_move_result::illegal_take;
-		stone[x][y] = who; // is legal move!
+		if (x < 0 || x >= size_x || y < 0 || y >= size_y) return nogo_move_result::illegal_out_of_range;
+		unsigned i = point(x, y).i;
+		bitboard at = bitboard::bit(i);
+		if ((at & space_mask()).empty())         return nogo_move_result::illegal_out_of_range;
+		if ((at & (stone[0] | stone[1])).any()) return nogo_move_result::illegal_not_empty;
+		bitboard near = geometry::neighbor[i];
+		bool alive = (near & pieces(piece_type::empty)).any(); // alive if any of the merged blocks has another liberty
+		for (bitboard own = near & stone[who - 1]; own.any() && !alive; ) {
+			alive = liberty[chain[own.pop()]] > 1;
+		}
+		if (!alive) return nogo_move_result::illegal_suicide;
+		for (bitboard foe = near & stone[2 - who]; foe.any(); ) {
+			if (liberty[chain[foe.pop()]] == 1) return nogo_move_result::illegal_take;
+		}
+		return nogo_move_result::legal;
+	}
+	bool is_legal(const point& p, unsigned who = piece_type::unknown) const {
+		return check_move(p.x, p.y, who) == nogo_move_result::legal;
+	}
+
+	/**
+	 * place a stone to the specific position
+	 * who == piece_type::unknown indicates automatically play as the next side
+	 * return nogo_move_result::legal if the action is valid, or nogo_move_result::illegal_* if not
+	 */
+	reward place(int x, int y, unsigned who = piece_type::unknown) {
+		if (who == -1u) who = attr.who_take_turns;
+		reward result = check_move(x, y, who);
+		if (result != nogo_move_result::legal) return result;
+		unsigned i = point(x, y).i, opp = 3u - who;
+		bitboard at = bitboard::bit(i), near = geometry::neighbor[i];
+		bitboard space = near & pieces(piece_type::empty);
+		stone[who - 1] |= at; // is legal move!
+		for (unsigned s = 0; s < symmetries; s++) zobrist[s] ^= geometry::zobrist[who - 1][i][s];
+		bitboard taken; // the neighboring blocks of the opponent lose exactly one liberty
+		for (bitboard foe = near & stone[opp - 1]; foe.any(); ) {
+			unsigned root = chain[foe.pop()];
+			if (!taken.test(root)) liberty[root]--;
+			taken.set(root);
+		}
+		if ((near & stone[who - 1]).any()) { // merge the neighboring blocks into one
+			bitboard block = flood(at, stone[who - 1]);
+			unsigned root = chain[(near & stone[who - 1]).first()];
+			liberty[root] = (adjacent(block) & pieces(piece_type::empty)).count();
+			for (block.reset(root); block.any(); chain[block.pop()] = root);
+		} else {
+			chain[i] = i;
+			liberty[i] = space.count();
+		}
 		attr.who_take_turns = static_cast<piece_type>(opp);
 		return nogo_move_result::legal;
 	}
@@ -141,58 +302,85 @@ public:
 	 * return >= 0 if [x][y] is placed by who; otherwise return -1
 	 */
 	int check_liberty(int x, int y, unsigned who) const {
-		grid test = stone;
-		if (test[x][y] != who) return -1;
+		unsigned i = point(x, y).i;
+		bitboard own = pieces(who), from = bitboard::bit(i);
+		if ((own & from).empty() || who == piece_type::empty) return -1;
+		if (who == piece_type::hollow) return (dilate(flood(from, own)) & pieces(piece_type::empty)).count();
+		return liberty[chain[i]];
+	}
 
-		int liberty = 0;
-		std::list<point> check;
-		for (check.emplace_back(x, y); check.size(); check.pop_front()) {
-			int x = check.front().x, y = check.front().y;
-			test[x][y] = piece_type::unknown; // prevent recalculate
+	/**
+	 * get all the legal positions of who in one pass, regardless of whose turn it is
+	 * a position is legal if it is empty, it is next to a liberty or a block of who with other liberties,
+	 * and it is not the only liberty of any block of the opponent
+	 */
+	bitboard legal_moves(unsigned who) const {
+		bitboard space = pieces(piece_type::empty), alive = space, atari;
+		for (bitboard own = stone[who - 1]; own.any(); ) {
+			unsigned i = own.pop();
+			if (liberty[chain[i]] > 1) alive.set(i);
+		}
+		for (bitboard foe = stone[2 - who]; foe.any(); ) {
+			unsigned i = foe.pop();
+			if (liberty[chain[i]] == 1) atari.set(i);
+		}
+		return space & adjacent(alive) & ~adjacent(atari);
+	}
 
-			point p_min(0, 0), p_max(size_x - 1, size_y - 1);
+	/**
+	 * get the positions next to the given positions in four directions, restricted to the board
+	 */
+	static bitboard adjacent(const bitboard& m) {
+		bitboard near = (m << size_y) | (m >> size_y);
+		near |= ((m & ~top_mask()) << 1) | ((m & ~bottom_mask()) >> 1);
+		return near & board_mask();
+	}
 
-			cell near_l = x > p_min.x ? test[x - 1][y] : -1u; // left
-			if (near_l == piece_type::empty) liberty++;
-			else if (near_l == who) check.emplace_back(x - 1, y);
+	/**
+	 * expand the positions by one step in four directions, restricted to the board
+	 */
+	static bitboard dilate(const bitboard& m) {
+		return m | adjacent(m);
+	}
 
-			cell near_r = x < p_max.x ? test[x + 1][y] : -1u; // right
-			if (near_r == piece_type::empty) liberty++;
-			else if (near_r == who) check.emplace_back(x + 1, y);
+	/**
+	 * expand the seed repeatedly within the mask, i.e., find the blocks of mask connected to seed
+	 */
+	static bitboard flood(bitboard seed, const bitboard& mask) {
+		for (bitboard grow = dilate(seed) & mask; grow != seed; grow = dilate(seed) & mask) seed = grow;
+		return seed;
+	}
 
-			cell near_d = y > p_min.y ? test[x][y - 1] : -1u; // down
-			if (near_d == piece_type::empty) liberty++;
-			else if (near_d == who) check.emplace_back(x, y - 1);
+	/**
+	 * move the stone at the position (i) to the position symmetry[s][i], see board_shape::transform
+	 * note that hash(s) of this board becomes hash() after the transform
+	 */
+	void transform(unsigned s) {
+		if (s) remap([s](const point& p) { return point(int(geometry::symmetry[s][p.i])); });
+	}
 
-			cell near_u = y < p_max.y ? test[x][y + 1] : -1u; // up
-			if (near_u == piece_type::empty) liberty++;
-			else if (near_u == who) check.emplace_back(x, y + 1);
+	/**
+	 * map a set of positions back through symmetry (s), i.e., the inverse of transform(s) for the positions
+	 */
+	static bitboard untransform(const bitboard& m, unsigned s) {
+		if (s == 0) return m;
+		bitboard from;
+		for (unsigned i = 0; i < size_x * size_y; i++) {
+			if (m.test(geometry::symmetry[s][i])) from.set(i);
 		}
-		return liberty;
+		return from;
 	}
 
 	void transpose() {
-		for (int x = 0; x < size_x; x++) {
-			for (int y = x + 1; y < size_y; y++) {
-				std::swap(stone[x][y], stone[y][x]);
-			}
-		}
+		remap([](const point& p) { return point(p.y, p.x); });
 	}
 
 	void reflect_horizontal() {
-		for (int y = 0; y < size_y; y++) {
-			for (int x = 0; x < size_x / 2; x++) {
-				std::swap(stone[x][y], stone[size_x - 1 - x][y]);
-			}
-		}
+		remap([](const point& p) { return point(size_x - 1 - p.x, p.y); });
 	}
 
 	void reflect_vertical() {
-		for (int x = 0; x < size_x; x++) {
-			for (int y = 0; y < size_y / 2; y++) {
-				std::swap(stone[x][y], stone[x][size_y - 1 - y]);
-			}
-		}
+		remap([](const point& p) { return point(p.x, size_y - 1 - p.y); });
 	}
 
 	/**
@@ -213,7 +401,7 @@ public:
 	void reverse() { reflect_horizontal(); reflect_vertical(); }
 
 public:
-	friend std::ostream& operator <<(std::ostream& out, const board& b) {
+	friend std::ostream& operator <<(std::ostream& out, const basic_board& b) {
 		std::ios ff(nullptr);
 		ff.copyfmt(out); // make a copy of the original print format
 
@@ -242,7 +430,7 @@ public:
 		out.copyfmt(ff); // restore print format
 		return out;
 	}
-	friend std::istream& operator >>(std::istream& in, board& b) {
+	friend std::istream& operator >>(std::istream& in, basic_board& b) {
 		std::string token;
 		for (int x = 0; x < size_x; x++) in >> token; /* skip X */
 		for (int y = size_y - 1; y >= 0 && in >> token /* skip Y */; in >> token /* skip Y */, y--) {
@@ -273,15 +461,70 @@ public:
 	}
 
 protected:
-	static const grid& initial() { static grid stone; return stone; }
-	static __attribute__((constructor)) void init_initial_scheme() {
-		grid& stone = const_cast<grid&>(initial());
-		point hollow((size_x - hollow_x) / 2, (size_y - hollow_y) / 2);
-		for (int x = hollow.x; x < hollow.x + hollow_x; x++)
-			for (int y = hollow.y; y < hollow.y + hollow_y; y++)
-				stone[x][y] = piece_type::hollow;
+	template<typename transform>
+	void remap(transform move) {
+		for (bitboard& mask : stone) {
+			bitboard to;
+			for (bitboard from = mask; from.any(); ) to.set(move(point(from.pop())).i);
+			mask = to;
+		}
+		rebuild();
+	}
+
+	/**
+	 * overwrite the stone at the position (i) without updating the blocks
+	 */
+	void put(unsigned i, cell type) {
+		if (!space_mask().test(i)) return;
+		stone[0].reset(i);
+		stone[1].reset(i);
+		if (type == piece_type::black || type == piece_type::white) stone[type - 1].set(i);
 	}
+
+	/**
+	 * recalculate all the blocks from scratch
+	 */
+	void rebuild() {
+		bitboard space = pieces(piece_type::empty);
+		zobrist.fill(0);
+		for (unsigned who = 0; who < 2; who++) {
+			for (bitboard rest = stone[who]; rest.any(); ) {
+				unsigned i = rest.pop();
+				for (unsigned s = 0; s < symmetries; s++) zobrist[s] ^= geometry::zobrist[who][i][s];
+			}
+		}
+		for (const bitboard& mask : stone) {
+			for (bitboard rest = mask; rest.any(); ) {
+				unsigned root = rest.first();
+				bitboard block = flood(bitboard::bit(root), mask);
+				rest &= ~block;
+				liberty[root] = (adjacent(block) & space).count();
+				for (; block.any(); chain[block.pop()] = root);
+			}
+		}
+	}
+
+	static const bitboard& board_mask() { return geometry::board_mask; } // all positions
+	static const bitboard& hollow_mask() { return geometry::hollow_mask; } // the hollow positions
+	static const bitboard& space_mask() { return geometry::space_mask; } // positions for placing
+	static const bitboard& bottom_mask() { return geometry::bottom_mask; } // positions with y == 0
+	static const bitboard& top_mask() { return geometry::top_mask; } // positions with y == size_y - 1
 private:
-	grid stone;
+	std::array<bitboard, 2> stone; // the stones of black and white
+	std::array<uint8_t, size_x * size_y> chain; // the root of the block of each stone
+	std::array<uint8_t, size_x * size_y> liberty; // the number of liberties of each block, indexed by its root
+	std::array<uint64_t, symmetries> zobrist; // the zobrist hashes of the stones under each symmetry
 	data attr;
 };
+
+/**
+ * the board of the game, other variants can be selected at compile time, e.g.,
+ * -DBOARD_SIZE=11 for 11x11 Hollow NoGo, or -DBOARD_SIZE=7 -DHOLLOW_SIZE=0 for 7x7 NoGo without hollow
+ */
+#ifndef BOARD_SIZE
+#define BOARD_SIZE 9
+#endif
+#ifndef HOLLOW_SIZE
+#define HOLLOW_SIZE 3
+#endif
+typedef basic_board<BOARD_SIZE, BOARD_SIZE, HOLLOW_SIZE, HOLLOW_SIZE> board;
@@ -20,11 +20,13 @@
 #include "agent.h"
 
 class statistic;
+class record;
 
 class episode {
 friend class statistic;
+friend class record;
 public:
-	episode() : ep_state(initial_state()), ep_score(0), ep_time(0) {
+	episode() : ep_state(initial_state()), ep_score(0), ep_time(0), ep_spent() {
 		ep_moves.reserve(board::size_x * board::size_y);
 	}
 
@@ -43,6 +45,7 @@ public:
 		board::reward reward = move.apply(state());
 		if (reward != board::legal) return false;
 		ep_moves.emplace_back(move, reward, millisec() - ep_time);
+		ep_spent[(ep_moves.size() - 1) % 2] += ep_moves.back().time;
 		ep_score += reward;
 		return true;
 	}
@@ -72,11 +75,11 @@ public:
 		switch (who) {
 		case board::black:
 		case action::black::type:
-			for (size_t i = 0; i < ep_moves.size(); i += 2) time += ep_moves[i].time;
+			time = ep_spent[0];
 			break;
 		case board::white:
 		case action::white::type:
-			for (size_t i = 1; i < ep_moves.size(); i += 2) time += ep_moves[i].time;
+			time = ep_spent[1];
 			break;
 		case action::place::type:
 		default:
@@ -141,6 +144,7 @@ public:
 			while (ss.peek() == ';') {
 				ep.ep_moves.emplace_back();
 				ss >> ep.ep_moves.back();
+				ep.ep_spent[(ep.ep_moves.size() - 1) % 2] += ep.ep_moves.back().time;
 			}
 			ep.ep_score = 0;
 		} else {
@@ -202,6 +206,7 @@ private:
 	board::reward ep_score;
 	std::vector<move> ep_moves;
 	time_t ep_time;
+	time_t ep_spent[2]; // the total thinking time of black and white
 
 	meta ep_open;
 	meta ep_close;
@@ -0,0 +1,166 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * geometry.h: Compile-time masks and tables for boards with a hollow at the center
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include "bitboard.h"
+
+/**
+ * compile-time list of indices 0, 1, ..., n - 1, for generating tables element by element
+ */
+template<unsigned... i> struct index_list {};
+template<unsigned n, unsigned... i> struct make_index_list : make_index_list<n - 1, n - 1, i...> {};
+template<unsigned... i> struct make_index_list<0, i...> { typedef index_list<i...> type; };
+
+/**
+ * the shape of a (width x height) board with a (hollow_width x hollow_height) hollow at the center,
+ * positions are in 1-d array style, i.e., (i) == [i / height][i % height]
+ * the functions are used for generating the tables of board_geometry at compile time
+ */
+template<unsigned width, unsigned height, unsigned hollow_width, unsigned hollow_height>
+struct board_shape {
+	static_assert(width * height <= 128, "the board should fit in a bitboard");
+	static_assert(hollow_width <= width && hollow_height <= height, "the hollow should fit in the board");
+
+	static constexpr unsigned area = width * height;
+	static constexpr int hollow_x = (width - hollow_width) / 2;
+	static constexpr int hollow_y = (height - hollow_height) / 2;
+
+	/**
+	 * the hollow is invariant under the symmetries only if it is exactly at the center
+	 * note that the transposition (swapping x and y) is a symmetry only for square boards
+	 */
+	static constexpr bool centered = hollow_width * hollow_height == 0
+		|| ((width - hollow_width) % 2 == 0 && (height - hollow_height) % 2 == 0);
+	static constexpr unsigned symmetries = !centered ? 1 : (width == height ? 8 : 4);
+
+	static constexpr int x_of(unsigned i) { return i / height; }
+	static constexpr int y_of(unsigned i) { return i % height; }
+	static constexpr bool on_board(int x, int y) { return x >= 0 && x < int(width) && y >= 0 && y < int(height); }
+	static constexpr bool in_hollow(int x, int y) {
+		return x >= hollow_x && x < hollow_x + int(hollow_width) && y >= hollow_y && y < hollow_y + int(hollow_height);
+	}
+	static constexpr bool in_space(int x, int y) { return on_board(x, y) && !in_hollow(x, y); }
+	static constexpr bitboard bit_if(bool cond, int x, int y) { return cond ? bitboard::bit(x * height + y) : bitboard(); }
+
+	enum mask_type { all, hollow, space, bottom, top };
+	static constexpr bool is(mask_type type, int x, int y) {
+		return type == all    ? on_board(x, y)
+		     : type == hollow ? in_hollow(x, y)
+		     : type == space  ? in_space(x, y)
+		     : type == bottom ? y == 0
+		     :                  y == int(height) - 1;
+	}
+	static constexpr bitboard mask(mask_type type, unsigned i = 0) {
+		return i < area ? bit_if(is(type, x_of(i), y_of(i)), x_of(i), y_of(i)) | mask(type, i + 1) : bitboard();
+	}
+
+	/**
+	 * the positions for placing next to [x][y] in four directions
+	 */
+	static constexpr bitboard neighbor(int x, int y) {
+		return bit_if(in_space(x - 1, y), x - 1, y) | bit_if(in_space(x + 1, y), x + 1, y)
+		     | bit_if(in_space(x, y - 1), x, y - 1) | bit_if(in_space(x, y + 1), x, y + 1);
+	}
+	template<unsigned... i>
+	static constexpr std::array<bitboard, area> neighbor_table(index_list<i...>) {
+		return {{ neighbor(x_of(i), y_of(i))... }};
+	}
+
+	/**
+	 * where [x][y] goes under symmetry (s)
+	 * bit 2 of s swaps x and y (transpose), bit 0 of s flips x, and bit 1 of s flips y
+	 */
+	static constexpr uint8_t flip(unsigned s, int x, int y) {
+		return ((s & 1) ? int(width) - 1 - x : x) * height + ((s & 2) ? int(height) - 1 - y : y);
+	}
+	static constexpr uint8_t transform(unsigned s, unsigned i) {
+		return (s & 4) ? flip(s, y_of(i), x_of(i)) : flip(s, x_of(i), y_of(i));
+	}
+	template<unsigned... i>
+	static constexpr std::array<uint8_t, area> symmetry_row(unsigned s, index_list<i...>) {
+		return {{ transform(s, i)... }};
+	}
+	template<unsigned... s>
+	static constexpr std::array<std::array<uint8_t, area>, 8> symmetry_table(index_list<s...>) {
+		return {{ symmetry_row(s, typename make_index_list<area>::type())... }};
+	}
+
+	/**
+	 * the zobrist key of who (1 or 2) at the position (i), generated by splitmix64 with a fixed seed
+	 */
+	static constexpr uint64_t mix(uint64_t z, uint64_t m, unsigned r) { return (z ^ (z >> r)) * m; }
+	static constexpr uint64_t fold(uint64_t z) { return z ^ (z >> 31); }
+	static constexpr uint64_t splitmix(uint64_t z) {
+		return fold(mix(mix(z, 0xbf58476d1ce4e5b9ull, 30), 0x94d049bb133111ebull, 27));
+	}
+	static constexpr uint64_t key(unsigned who, unsigned i) {
+		return splitmix(0x9e3779b97f4a7c15ull * ((who - 1) * area + i + 2));
+	}
+	template<unsigned... s>
+	static constexpr std::array<uint64_t, 8> key_row(unsigned who, unsigned i, index_list<s...>) {
+		return {{ (s < symmetries ? key(who, transform(s, i)) : 0)... }};
+	}
+	template<unsigned... i>
+	static constexpr std::array<std::array<uint64_t, 8>, area> key_table(unsigned who, index_list<i...>) {
+		return {{ key_row(who, i, typename make_index_list<8>::type())... }};
+	}
+};
+
+/**
+ * the compile-time masks and tables of a board shape
+ */
+template<unsigned width, unsigned height, unsigned hollow_width, unsigned hollow_height>
+struct board_geometry : board_shape<width, height, hollow_width, hollow_height> {
+	typedef board_shape<width, height, hollow_width, hollow_height> shape;
+
+	static constexpr bitboard board_mask = shape::mask(shape::all); // all positions
+	static constexpr bitboard hollow_mask = shape::mask(shape::hollow); // the hollow positions
+	static constexpr bitboard space_mask = shape::mask(shape::space); // positions for placing
+	static constexpr bitboard bottom_mask = shape::mask(shape::bottom); // positions with y == 0
+	static constexpr bitboard top_mask = shape::mask(shape::top); // positions with y == height - 1
+
+	/**
+	 * neighbor[i] is the positions for placing next to the position (i)
+	 */
+	static constexpr std::array<bitboard, shape::area> neighbor =
+		shape::neighbor_table(typename make_index_list<shape::area>::type());
+
+	/**
+	 * symmetry[s][i] is where the position (i) goes under symmetry (s), see board_shape::transform
+	 */
+	static constexpr std::array<std::array<uint8_t, shape::area>, 8> symmetry =
+		shape::symmetry_table(typename make_index_list<8>::type());
+
+	/**
+	 * zobrist[who - 1][i][s] is the zobrist key of who at the position where (i) goes under symmetry (s)
+	 */
+	static constexpr std::array<std::array<std::array<uint64_t, 8>, shape::area>, 2> zobrist = {{
+		shape::key_table(1, typename make_index_list<shape::area>::type()),
+		shape::key_table(2, typename make_index_list<shape::area>::type()),
+	}};
+};
+
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr bitboard board_geometry<w, h, hw, hh>::board_mask;
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr bitboard board_geometry<w, h, hw, hh>::hollow_mask;
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr bitboard board_geometry<w, h, hw, hh>::space_mask;
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr bitboard board_geometry<w, h, hw, hh>::bottom_mask;
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr bitboard board_geometry<w, h, hw, hh>::top_mask;
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr std::array<bitboard, board_geometry<w, h, hw, hh>::shape::area> board_geometry<w, h, hw, hh>::neighbor;
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr std::array<std::array<uint8_t, board_geometry<w, h, hw, hh>::shape::area>, 8> board_geometry<w, h, hw, hh>::symmetry;
+template<unsigned w, unsigned h, unsigned hw, unsigned hh>
+constexpr std::array<std::array<std::array<uint64_t, 8>, board_geometry<w, h, hw, hh>::shape::area>, 2> board_geometry<w, h, hw, hh>::zobrist;
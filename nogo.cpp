@@ -11,22 +11,37 @@
 #include <fstream>
 #include <iterator>
 #include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <limits>
+#include <random>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
 #include "episode.h"
 #include "statistic.h"
+#include "record.h"
+#include "recorder.h"
+#include "scheduler.h"
+#include "tournament.h"
 
 int main(int argc, const char* argv[]) {
 	std::cout << "HollowNoGo-Demo: ";
 	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
 	std::cout << std::endl << std::endl;
 
-	size_t total = 1000, block = 0, limit = 0;
+	size_t total = 1000, block = 0, limit = 0, parallel = 0;
 	std::string black_args, white_args;
+	std::vector<std::string> entrants; // for a tournament
+	std::string test;
 	std::string load, save;
 	std::string name = "TCG-HollowNoGo-Demo", version = "2021"; // for GTP shell
-	bool summary = false, shell = false;
+	bool summary = false, shell = false, convert = false, resume = false;
+	std::string stream; // "y" to write the records as they are closed, or "async" to write them on another thread
 	for (int i = 1; i < argc; i++) {
 		std::string para(argv[i]);
 		if (para.find("--total=") == 0) {
@@ -35,10 +50,16 @@ int main(int argc, const char* argv[]) {
 			block = std::stoull(para.substr(para.find("=") + 1));
 		} else if (para.find("--limit=") == 0) {
 			limit = std::stoull(para.substr(para.find("=") + 1));
+		} else if (para.find("--parallel=") == 0) {
+			parallel = std::stoull(para.substr(para.find("=") + 1));
 		} else if (para.find("--black=") == 0) {
 			black_args = para.substr(para.find("=") + 1);
 		} else if (para.find("--white=") == 0) {
 			white_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--agent=") == 0) {
+			entrants.push_back(para.substr(para.find("=") + 1));
+		} else if (para.find("--sprt=") == 0) {
+			test = para.substr(para.find("=") + 1);
 		} else if (para.find("--load=") == 0) {
 			load = para.substr(para.find("=") + 1);
 		} else if (para.find("--save=") == 0) {
@@ -47,6 +68,14 @@ int main(int argc, const char* argv[]) {
 			name = para.substr(para.find("=") + 1);
 		} else if (para.find("--version=") == 0) {
 			version = para.substr(para.find("=") + 1);
+		} else if (para.find("--stream=") == 0) {
+			stream = para.substr(para.find("=") + 1);
+		} else if (para.find("--stream") == 0) {
+			stream = "y";
+		} else if (para.find("--resume") == 0) {
+			resume = true;
+		} else if (para.find("--convert") == 0) {
+			convert = true;
 		} else if (para.find("--summary") == 0) {
 			summary = true;
 		} else if (para.find("--shell") == 0) {
@@ -54,40 +83,195 @@ int main(int argc, const char* argv[]) {
 		}
 	}
 
+	// the records are saved in the binary format if the file name ends with ".bin", see record
+	// and loaded in the binary format if the file begins with its header
+	bool binary = save.size() > 4 && save.compare(save.size() - 4, 4, ".bin") == 0;
+
+	if (convert) { // convert the records from load to save one by one, without keeping them
+		std::ofstream out(save, std::ios::out | std::ios::trunc | std::ios::binary);
+		std::unique_ptr<record_writer> writer(binary ? new record_writer(out) : nullptr);
+		episode ep;
+		auto emit = [&]() {
+			if (writer) *writer << ep;
+			else out << ep << std::endl;
+		};
+		if (record::is_binary(load)) {
+			record_file file(load);
+			if (!file.good()) std::cerr << "invalid records: " << load << std::endl;
+			for (record rec : file) {
+				rec.load(ep);
+				emit();
+			}
+		} else {
+			std::ifstream in(load, std::ios::in);
+			for (std::string line; std::getline(in, line) && line.size(); ) {
+				std::stringstream(line) >> ep;
+				emit();
+			}
+		}
+		return 0;
+	}
+
+	if (entrants.size() > 1 && save.size()) { // the pairings keep only their results, see tournament
+		std::cerr << "the games of a tournament are not saved: " << save << std::endl;
+		save.clear();
+	}
+
+	if (save.size() && (stream.size() || resume) && limit == 0) { // the records are on the disk, so keep a block of them
+		limit = std::min<size_t>(block ? block : 1000, total);
+	}
+
 	statistic stat(total, block, limit);
 
 	if (load.size()) {
-		std::ifstream in(load, std::ios::in);
-		in >> stat;
-		in.close();
+		if (record::is_binary(load)) {
+			record_file file(load);
+			if (!file.good()) std::cerr << "invalid records: " << load << std::endl;
+			std::vector<episode> records;
+			for (record rec : file) {
+				records.emplace_back();
+				rec.load(records.back());
+			}
+			stat.load(records);
+		} else {
+			std::ifstream in(load, std::ios::in);
+			in >> stat;
+			in.close();
+		}
 		summary |= stat.is_finished();
 	}
 
+	// the seed of the player arguments shifted by (shift), or a random seed if there is none
+	auto seeded = [](const std::string& args, size_t shift) {
+		size_t at = (" " + args).rfind(" seed=");
+		unsigned seed = at != std::string::npos ? std::stoul(args.substr(at + 5)) : std::random_device()();
+		return args + " seed=" + std::to_string((seed + shift) & 0x7fffffff);
+	};
+
+	// the records are appended to the save file once they are closed, so that an interrupted run can be resumed,
+	// in which case only the last (limit) records are kept in memory
+	std::unique_ptr<recorder> writer;
+	if (save.size() && (stream.size() || resume)) {
+		if (resume) {
+			size_t games = recorder::recover(save, [&](episode&& ep) { stat.load(std::move(ep)); });
+			if (games) { // continue the sequence of games instead of replaying it from the first game
+				black_args = seeded(black_args, 1000003 * games);
+				white_args = seeded(white_args, 1000003 * games);
+			}
+			binary = record::is_binary(save) || binary;
+		} else {
+			std::ofstream(save, std::ios::out | std::ios::trunc);
+		}
+		writer.reset(new recorder(save, binary, stream == "async"));
+		stat.stream([&](const episode& ep) { writer->write(ep); });
+	}
+
 	player black("name=black " + black_args + " role=black");
 	player white("name=white " + white_args + " role=white");
 
-	if (!shell) { // launch standard local games
-		while (!stat.is_finished()) {
-			black.open_episode("~:" + white.name());
-			white.open_episode(black.name() + ":~");
+	auto play = [](agent& black, agent& white, statistic& stat) { // play a game and record it in stat
+		black.open_episode("~:" + white.name());
+		white.open_episode(black.name() + ":~");
 
-			stat.open_episode(black.name() + ":" + white.name());
-			episode& game = stat.back();
-			while (true) {
-				agent& who = game.take_turns(black, white);
-				action move = who.take_action(game.state());
-				if (game.apply_action(move) != true) break;
-				if (who.check_for_win(game.state())) break;
+		stat.open_episode(black.name() + ":" + white.name());
+		episode& game = stat.back();
+		while (true) {
+			agent& who = game.take_turns(black, white);
+			action move = who.take_action(game.state());
+			if (game.apply_action(move) != true) break;
+			if (who.check_for_win(game.state())) break;
+		}
+		agent& win = game.last_turns(black, white);
+		stat.close_episode(win.name());
+
+		black.close_episode(win.name());
+		white.close_episode(win.name());
+	};
+
+	if (entrants.size() > 1) { // launch a round-robin tournament of the agents, where total is the games of each pairing
+		tournament league(entrants, total, test, block);
+		league.run(play, std::max<size_t>(parallel, 1));
+		league.summary();
+
+	} else if (!shell && parallel) { // launch local games in parallel
+		// each worker has its own players, whose seeds are shifted by the index of the worker
+		work_stealing_pool pool(parallel);
+		std::vector<std::unique_ptr<player>> blacks, whites;
+		std::vector<statistic> shards; // the game in progress of each worker
+		for (size_t w = 0; w < pool.size(); w++) {
+			blacks.emplace_back(w ? new player("name=black " + seeded(black_args, 1000 * w) + " role=black") : nullptr);
+			whites.emplace_back(w ? new player("name=white " + seeded(white_args, 1000 * w) + " role=white") : nullptr);
+			shards.emplace_back(std::numeric_limits<size_t>::max(), 0, 1);
+		}
+
+		// the finished games are merged into stat in the order of the games
+		std::map<size_t, episode> finished;
+		std::mutex lock;
+		std::condition_variable ready;
+		size_t games = stat.remaining();
+		bool failed = false; // whether a worker has thrown, which is then rethrown by pool.join
+		pool.launch(games, [&](size_t w, size_t i) {
+			try {
+				play(w ? *blacks[w] : black, w ? *whites[w] : white, shards[w]);
+			} catch (...) {
+				std::lock_guard<std::mutex> guard(lock);
+				failed = true;
+				ready.notify_all();
+				throw;
 			}
-			agent& win = game.last_turns(black, white);
-			stat.close_episode(win.name());
+			std::lock_guard<std::mutex> guard(lock);
+			finished.emplace(i, std::move(shards[w].back()));
+			ready.notify_all();
+		});
+		for (size_t i = 0; i < games; i++) {
+			std::unique_lock<std::mutex> guard(lock);
+			ready.wait(guard, [&]() { return finished.count(i) || failed; });
+			if (!finished.count(i)) break;
+			episode game = std::move(finished.at(i));
+			finished.erase(i);
+			guard.unlock();
+			stat.add_episode(std::move(game));
+		}
+		pool.join();
 
-			black.close_episode(win.name());
-			white.close_episode(win.name());
+	} else if (!shell) { // launch standard local games
+		while (!stat.is_finished()) {
+			play(black, white, stat);
 		}
 	} else { // launch GTP shell
-		for (std::string command; std::getline(std::cin, command); ) {
-			if (command.back() == '\r') command.pop_back();
+		// the commands are read by another thread, so that the shell can interrupt a search by the next command
+		struct input {
+			std::deque<std::string> commands;
+			bool closed = false;
+			std::mutex lock;
+			std::condition_variable arrival;
+			bool aborting() const { // whether a command that ends the game is waiting
+				for (const std::string& command : commands)
+					if (command.find("quit") == 0 || command.find("clear_board") == 0) return true;
+				return closed;
+			}
+		};
+		std::shared_ptr<input> in = std::make_shared<input>();
+		std::thread([in]() {
+			for (std::string command; std::getline(std::cin, command); ) {
+				std::lock_guard<std::mutex> lock(in->lock);
+				in->commands.push_back(command);
+				in->arrival.notify_all();
+			}
+			std::lock_guard<std::mutex> lock(in->lock);
+			in->closed = true;
+			in->arrival.notify_all();
+		}).detach();
+
+		for (std::string command; ; ) {
+			{
+				std::unique_lock<std::mutex> lock(in->lock);
+				in->arrival.wait(lock, [&]() { return in->commands.size() || in->closed; });
+				if (in->commands.empty()) break;
+				command = in->commands.front();
+				in->commands.pop_front();
+			}
+			if (command.size() && command.back() == '\r') command.pop_back();
 			if (command.empty()) continue;
 
 			std::vector<std::string> args;
@@ -136,9 +320,29 @@ int main(int argc, const char* argv[]) {
 						break;
 					}
 				} else if (args[0] == "genmove") { // generate a move and play
-					action::place move = who.take_action(game.state());
+					// search on another thread, which is interrupted if the game is ended by the next command
+					agent& other = game.last_turns(black, white);
+					other.stop();
+					action::place move;
+					bool done = false;
+					std::thread search([&]() {
+						action::place result = who.take_action(game.state());
+						std::lock_guard<std::mutex> lock(in->lock);
+						move = result;
+						done = true;
+						in->arrival.notify_all();
+					});
+					bool aborting = false;
+					{
+						std::unique_lock<std::mutex> lock(in->lock);
+						in->arrival.wait(lock, [&]() { return done || in->aborting(); });
+						aborting = !done;
+					}
+					if (aborting) who.interrupt();
+					search.join();
 					if (game.apply_action(move) == true) {
 						reply = move.position();
+						who.ponder(game.state()); // think about the replies while the opponent is thinking
 					} else { // I have no legal move to play
 						reply = "resign";
 					}
@@ -153,6 +357,14 @@ int main(int argc, const char* argv[]) {
 				}
 				if (args[0] == "quit") break; // quit GTP shell
 
+			} else if (args[0] == "time_settings" && args.size() >= 4) { // set the time system for both players
+				black.notify("time_settings=" + args[1] + " " + args[2] + " " + args[3]);
+				white.notify("time_settings=" + args[1] + " " + args[2] + " " + args[3]);
+
+			} else if (args[0] == "time_left" && args.size() >= 4) { // update the remaining time of a player
+				agent& who = (std::tolower(args[1][0]) == 'b') ? static_cast<agent&>(black) : static_cast<agent&>(white);
+				who.notify("time_left=" + args[2] + " " + args[3]);
+
 			} else if (args[0] == "showboard") { // print the board
 				std::stringstream buf;
 				buf << (stat.is_episode_ongoing() ? stat.back().state() : board());
@@ -173,7 +385,7 @@ int main(int argc, const char* argv[]) {
 			} else if (args[0] == "protocol_version") { // report GTP protocol version
 				reply = "2";
 			} else if (args[0] == "list_commands") { // print supported commands
-				reply = "play\n" "genmove\n" "clear_board\n" "showboard\n" "boardsize\n"
+				reply = "play\n" "genmove\n" "clear_board\n" "time_settings\n" "time_left\n" "showboard\n" "boardsize\n"
 				        "name\n" "version\n" "protocol_version\n" "list_commands\n" "quit\n";
 			} else {
 				reply = "unknown command";
@@ -187,7 +399,14 @@ int main(int argc, const char* argv[]) {
 		stat.summary();
 	}
 
-	if (save.size()) {
+	if (writer) {
+		writer->close();
+	} else if (save.size() && binary) {
+		std::ofstream out(save, std::ios::out | std::ios::trunc | std::ios::binary);
+		record_writer writer(out);
+		for (size_t i = 0; i < stat.size(); i++) writer << stat.at(i);
+		out.close();
+	} else if (save.size()) {
 		std::ofstream out(save, std::ios::out | std::ios::trunc);
 		out << stat;
 		out.close();
@@ -0,0 +1,210 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * pattern.h: 3x3 patterns around the moves and their weights learned from game records
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include "bitboard.h"
+#include "board.h"
+#include "record.h"
+
+/**
+ * the pattern of a move is the 8 cells around it, each of which is vacant, own, opponent, or out,
+ * where out stands for both the outside of the board and the hollow, so a pattern is coded in 16 bits
+ * patterns that are symmetric to each other share the same weight
+ *
+ * the weight of a pattern is its strength in the Bradley-Terry model, i.e., a move is chosen with the probability
+ * proportional to its weight, which is learned from the moves of the winners in the saved game records
+ * by minorization-maximization, see learn; the weights are stored as integers in units of 1 / unit
+ */
+template<typename board_type>
+class pattern_table {
+public:
+	typedef typename board_type::piece_type piece_type;
+	enum { area = board_type::size_x * board_type::size_y, codes = 1 << 16, unit = 256 };
+	enum cell { vacant = 0, own = 1, opponent = 2, out = 3 };
+
+	pattern_table() : weights(codes, unit), trained(false) {
+		static const int dx[] = { -1, 0, 1, -1, 1, -1, 0, 1 }, dy[] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+		for (unsigned i = 0; i < area; i++) {
+			typename board_type::point p(i);
+			for (unsigned k = 0; k < 8; k++) {
+				int x = p.x + dx[k], y = p.y + dy[k];
+				bool inside = x >= 0 && x < board_type::size_x && y >= 0 && y < board_type::size_y;
+				near[i][k] = inside && board_type::geometry::space_mask.test(typename board_type::point(x, y).i) ?
+				             typename board_type::point(x, y).i : -1;
+			}
+			base[i] = 0;
+			for (unsigned k = 0; k < 8; k++) base[i] |= (near[i][k] < 0 ? out : vacant) << (2 * k);
+		}
+		// the cell k moves to the cell permute[s][k] by the symmetry s
+		unsigned permute[8][8];
+		for (unsigned s = 0; s < 8; s++) {
+			for (unsigned k = 0; k < 8; k++) {
+				int x = (s & 1) ? -dx[k] : dx[k], y = (s & 2) ? -dy[k] : dy[k];
+				if (s & 4) std::swap(x, y);
+				for (permute[s][k] = 0; dx[permute[s][k]] != x || dy[permute[s][k]] != y; permute[s][k]++);
+			}
+		}
+		canonical.resize(codes);
+		for (unsigned code = 0; code < codes; code++) {
+			unsigned least = code;
+			for (unsigned s = 1; s < 8; s++) {
+				unsigned moved = 0;
+				for (unsigned k = 0; k < 8; k++) moved |= ((code >> (2 * k)) & 3) << (2 * permute[s][k]);
+				least = std::min(least, moved);
+			}
+			canonical[code] = least;
+		}
+	}
+
+public:
+	/**
+	 * the pattern of placing at position (i) by who
+	 */
+	unsigned code(const board_type& state, unsigned i, unsigned who) const {
+		bitboard self = state.pieces(who), other = state.pieces(3u - who);
+		unsigned code = 0;
+		for (unsigned k = 0; k < 8; k++) {
+			int j = near[i][k];
+			unsigned c = j < 0 ? out : self.test(j) ? own : other.test(j) ? opponent : vacant;
+			code |= c << (2 * k);
+		}
+		return code;
+	}
+
+	/**
+	 * the pattern of position (i) on the empty board, i.e., with only the out cells
+	 */
+	unsigned blank(unsigned i) const { return base[i]; }
+
+	/**
+	 * the pattern of the opponent at the same position, i.e., with own and opponent swapped
+	 */
+	static unsigned invert(unsigned code) { return ((code & 0x5555) << 1) | ((code & 0xaaaa) >> 1); }
+
+	/**
+	 * the positions around position (i), or -1 for the cells out of the board,
+	 * note that the cell k of position (i) is position near[i][k], whose cell (7 - k) is position (i)
+	 */
+	const int* neighbors(unsigned i) const { return near[i]; }
+
+	/**
+	 * the weight of placing at position (i) by who, or of the pattern, in units of 1 / unit
+	 */
+	uint32_t weight(const board_type& state, unsigned i, unsigned who) const { return weights[code(state, i, who)]; }
+	uint32_t weight(unsigned code) const { return weights[code]; }
+	float gamma(const board_type& state, unsigned i, unsigned who) const { return float(weight(state, i, who)) / unit; }
+
+	/**
+	 * whether the weights have been learned, otherwise all the weights are 1
+	 */
+	bool empty() const { return !trained; }
+
+public:
+	/**
+	 * learn the weights from the game records saved by statistic, either one game per line in the text format,
+	 * or the binary records (see record), return the number of games
+	 *
+	 * for each position in which the winner moved, the pattern of the played move wins against the patterns
+	 * of all the legal moves; each iteration updates the weight of pattern i to (W_i + 1) / (C_i + 1),
+	 * where W_i is the number of wins of pattern i, and C_i sums 1 / E_j over the positions j that it appears in
+	 * (once for each appearance), with E_j the total weight of the legal moves of position j
+	 */
+	size_t learn(std::istream& in, unsigned iterations = 8) {
+		std::vector<uint16_t> pattern;
+		std::vector<uint32_t> offset = { 0 };
+		size_t games = 0;
+		for (std::string line; std::getline(in, line); ) {
+			std::vector<unsigned> moves;
+			for (size_t k = line.find(";B["); k != std::string::npos && k + 5 < line.size(); k = line.find(';', k + 1)) {
+				if ((line[k + 1] != 'B' && line[k + 1] != 'W') || line[k + 2] != '[') continue;
+				int x = line[k + 3] - 'a', y = (board_type::size_y - 1) - (line[k + 4] - 'a');
+				moves.push_back(typename board_type::point(x, y).i);
+			}
+			if (moves.empty()) continue;
+			games++;
+			observe(moves, pattern, offset);
+		}
+		fit(pattern, offset, iterations);
+		trained = games != 0;
+		return games;
+	}
+	size_t learn(const record_file& file, unsigned iterations = 8) {
+		std::vector<uint16_t> pattern;
+		std::vector<uint32_t> offset = { 0 };
+		size_t games = 0;
+		std::vector<unsigned> moves;
+		for (record rec : file) {
+			if (rec.step() == 0) continue;
+			moves.assign(rec.moves(), rec.moves() + rec.step());
+			games++;
+			observe(moves, pattern, offset);
+		}
+		fit(pattern, offset, iterations);
+		trained = games != 0;
+		return games;
+	}
+
+private:
+	/**
+	 * append the patterns of the positions in which the winner moved, where pattern holds the patterns of the legal moves
+	 * of all positions with the played one first, and the patterns of position j are [offset[j], offset[j + 1])
+	 */
+	void observe(const std::vector<unsigned>& moves, std::vector<uint16_t>& pattern, std::vector<uint32_t>& offset) const {
+		unsigned winner = (moves.size() % 2) ? board_type::black : board_type::white; // the last mover wins
+		board_type state;
+		for (unsigned move : moves) {
+			unsigned who = state.info().who_take_turns;
+			if (who == winner) {
+				pattern.push_back(canonical[code(state, move, who)]);
+				for (bitboard legal = state.legal_moves(who); legal.any(); ) {
+					unsigned i = legal.pop();
+					if (i != move) pattern.push_back(canonical[code(state, i, who)]);
+				}
+				offset.push_back(pattern.size());
+			}
+			if (state.place(typename board_type::point(move)) != board_type::legal) break;
+		}
+	}
+
+	/**
+	 * run the minorization-maximization on the observed positions, and store the weights
+	 */
+	void fit(const std::vector<uint16_t>& pattern, const std::vector<uint32_t>& offset, unsigned iterations) {
+		std::vector<double> gamma(codes, 1.0), wins(codes, 0.0), seen(codes);
+		for (size_t j = 0; j + 1 < offset.size(); j++) wins[pattern[offset[j]]] += 1;
+		for (unsigned n = 0; n < iterations; n++) {
+			std::fill(seen.begin(), seen.end(), 0.0);
+			for (size_t j = 0; j + 1 < offset.size(); j++) {
+				double total = 0;
+				for (uint32_t k = offset[j]; k < offset[j + 1]; k++) total += gamma[pattern[k]];
+				for (uint32_t k = offset[j]; k < offset[j + 1]; k++) seen[pattern[k]] += 1 / total;
+			}
+			for (unsigned c = 0; c < codes; c++) {
+				if (seen[c] > 0) gamma[c] = (wins[c] + 1) / (seen[c] + 1);
+			}
+		}
+		for (unsigned code = 0; code < codes; code++) {
+			double w = std::round(gamma[canonical[code]] * unit);
+			weights[code] = uint16_t(std::min(std::max(w, 1.0), 65535.0));
+		}
+	}
+
+private:
+	std::vector<uint16_t> weights; // the weight of each pattern
+	std::vector<uint16_t> canonical; // the least code among the symmetric patterns
+	int near[area][8];
+	uint16_t base[area];
+	bool trained;
+};
@@ -0,0 +1,261 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * playout.h: Fast random generator and random playouts with incremental candidate lists or pattern weights
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include "bitboard.h"
+#include "board.h"
+#include "pattern.h"
+
+/**
+ * xoshiro256** generator by Blackman and Vigna, seeded by splitmix64
+ * it satisfies the requirements of uniform random bit generators, so it also works with std distributions
+ */
+class xoshiro256 {
+public:
+	typedef uint64_t result_type;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return ~0ull; }
+
+	explicit xoshiro256(uint64_t seed = 0) { this->seed(seed); }
+	void seed(uint64_t seed) {
+		for (uint64_t& x : s) {
+			uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			x = z ^ (z >> 31);
+		}
+	}
+
+	result_type operator()() {
+		uint64_t result = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+
+	/**
+	 * a uniform integer in [0, n), by a multiplication instead of a division (Lemire's method without rejection)
+	 * the bias is at most n / 2^32, which is negligible for choosing moves
+	 */
+	uint32_t below(uint32_t n) { return (uint64_t(uint32_t(operator()() >> 32)) * n) >> 32; }
+
+private:
+	static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+	uint64_t s[4];
+};
+
+/**
+ * a random playout that keeps the candidate moves of both sides in lists
+ *
+ * the lists are initialized by board::legal_moves, and a candidate is removed in O(1) by swapping with the last one,
+ * either when the position is taken, or when it becomes illegal for the side, since an illegal move in NoGo
+ * will never be legal again; thus sampling the lists until a legal move is found is uniform over the legal moves
+ */
+template<typename board_type>
+class random_playout {
+public:
+	typedef typename board_type::piece_type piece_type;
+	enum { area = board_type::size_x * board_type::size_y, none = 0xff };
+
+	random_playout(const board_type& state) : state(state) {
+		for (unsigned c = 0; c < 2; c++) {
+			size[c] = 0;
+			std::fill(where[c], where[c] + area, uint8_t(none));
+			for (bitboard moves = state.legal_moves(c + 1); moves.any(); ) {
+				unsigned i = moves.pop();
+				where[c][i] = size[c];
+				list[c][size[c]++] = i;
+			}
+		}
+	}
+
+	/**
+	 * play random moves starting from who, until the side to move has no legal move, return the winner
+	 */
+	piece_type run(piece_type who, xoshiro256& engine) {
+		for (;; who = static_cast<piece_type>(3u - who)) {
+			unsigned c = who - 1;
+			for (;;) {
+				if (size[c] == 0) return static_cast<piece_type>(3u - who);
+				unsigned i = list[c][engine.below(size[c])];
+				if (state.place(typename board_type::point(i), who) == board_type::legal) {
+					remove(0, i);
+					remove(1, i);
+					break;
+				}
+				remove(c, i);
+			}
+		}
+	}
+
+	const board_type& position() const { return state; }
+
+private:
+	void remove(unsigned c, unsigned i) {
+		unsigned k = where[c][i];
+		if (k == none) return;
+		unsigned last = list[c][--size[c]];
+		list[c][k] = last;
+		where[c][last] = k;
+		where[c][i] = none;
+	}
+
+private:
+	board_type state;
+	uint8_t list[2][area]; // the candidate moves of black and white
+	uint8_t where[2][area]; // the index of each position in the lists, or none
+	unsigned size[2];
+};
+
+/**
+ * a Fenwick tree of the integer weights of n items, for sampling an item proportionally to its weight,
+ * both updating a weight and sampling take O(log n)
+ */
+template<unsigned n>
+class weighted_sampler {
+public:
+	weighted_sampler() : tree(), value(), sum(0) {}
+
+	/**
+	 * set all the weights at once in O(n)
+	 */
+	void assign(const uint32_t* weights) {
+		std::copy(weights, weights + n, value);
+		std::fill(tree, tree + n + 1, 0);
+		sum = 0;
+		for (unsigned k = 1; k <= n; k++) {
+			tree[k] += value[k - 1];
+			sum += value[k - 1];
+			unsigned up = k + (k & -k);
+			if (up <= n) tree[up] += tree[k];
+		}
+	}
+
+	void update(unsigned i, uint32_t weight) {
+		uint32_t delta = weight - value[i]; // wraps around for a decrease
+		value[i] = weight;
+		sum += delta;
+		for (unsigned k = i + 1; k <= n; k += k & -k) tree[k] += delta;
+	}
+
+	/**
+	 * the item at which the prefix sum of the weights exceeds r, where r should be less than total()
+	 */
+	unsigned find(uint32_t r) const {
+		unsigned at = 0;
+		for (unsigned step = top; step; step >>= 1) {
+			if (at + step <= n && tree[at + step] <= r) {
+				at += step;
+				r -= tree[at];
+			}
+		}
+		return at;
+	}
+
+	uint32_t weight(unsigned i) const { return value[i]; }
+	uint32_t total() const { return sum; }
+
+private:
+	static constexpr unsigned top = 1u << (31 - __builtin_clz(n)); // the highest power of 2 not above n
+	uint32_t tree[n + 1];
+	uint32_t value[n];
+	uint32_t sum;
+};
+
+/**
+ * a playout that samples the moves by the weights of their patterns, see pattern_table
+ *
+ * like random_playout, a candidate stays in the sampler of a side until it is taken or found illegal for the side,
+ * the patterns of black are kept incrementally, since a cell only changes from vacant to a stone in NoGo,
+ * and once a move is played, the weights of the candidates around it are updated
+ */
+template<typename board_type>
+class pattern_playout {
+public:
+	typedef typename board_type::piece_type piece_type;
+	typedef pattern_table<board_type> table_type;
+	enum { area = board_type::size_x * board_type::size_y };
+
+	pattern_playout(const board_type& state, const table_type& table) : state(state), table(table) {
+		for (unsigned i = 0; i < area; i++) code[i] = table.blank(i);
+		for (unsigned c = 0; c < 2; c++) {
+			for (bitboard stones = state.pieces(c + 1); stones.any(); ) mark(stones.pop(), c + 1);
+		}
+		for (unsigned c = 0; c < 2; c++) {
+			uint32_t weights[area] = {};
+			for (bitboard moves = state.legal_moves(c + 1); moves.any(); ) {
+				unsigned i = moves.pop();
+				weights[i] = weight(i, c);
+			}
+			sampler[c].assign(weights);
+		}
+	}
+
+	/**
+	 * play weighted random moves starting from who, until the side to move has no legal move, return the winner
+	 */
+	piece_type run(piece_type who, xoshiro256& engine) {
+		for (;; who = static_cast<piece_type>(3u - who)) {
+			weighted_sampler<area>& moves = sampler[who - 1];
+			for (;;) {
+				if (moves.total() == 0) return static_cast<piece_type>(3u - who);
+				unsigned i = moves.find(engine.below(moves.total()));
+				if (state.place(typename board_type::point(i), who) == board_type::legal) {
+					sampler[0].update(i, 0);
+					sampler[1].update(i, 0);
+					mark(i, who);
+					refresh(i);
+					break;
+				}
+				moves.update(i, 0);
+			}
+		}
+	}
+
+	const board_type& position() const { return state; }
+
+private:
+	/**
+	 * put a stone of who at position (i) into the patterns around it
+	 */
+	void mark(unsigned i, unsigned who) {
+		const int* near = table.neighbors(i);
+		unsigned cell = (who == board_type::black) ? table_type::own : table_type::opponent;
+		for (unsigned k = 0; k < 8; k++) {
+			if (near[k] >= 0) code[near[k]] |= cell << (2 * (7 - k));
+		}
+	}
+
+	/**
+	 * update the weights of the candidates around position (i)
+	 */
+	void refresh(unsigned i) {
+		const int* near = table.neighbors(i);
+		for (unsigned k = 0; k < 8; k++) {
+			if (near[k] < 0) continue;
+			for (unsigned c = 0; c < 2; c++) {
+				if (sampler[c].weight(near[k])) sampler[c].update(near[k], weight(near[k], c));
+			}
+		}
+	}
+
+	uint32_t weight(unsigned i, unsigned c) const { return table.weight(c ? table_type::invert(code[i]) : code[i]); }
+
+private:
+	board_type state;
+	const table_type& table;
+	weighted_sampler<area> sampler[2]; // the candidate moves of black and white
+	uint16_t code[area]; // the patterns of black
+};
@@ -0,0 +1,237 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * record.h: Compact binary game records and their memory-mapped reader
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "board.h"
+#include "action.h"
+
+/**
+ * the binary record of a game, which is a view into the mapped file
+ * the conversions from and to episode are templates, so that this file can be used without episode.h, e.g., by pattern.h
+ *
+ * a file begins with an 8-byte header, "TCGR" followed by the version, size_x, size_y, and a zero,
+ * and each game consists of
+ *   a 24-byte header (little-endian):
+ *     [0, 2) the length of the whole record in bytes, including this header
+ *     [2]    the number of moves
+ *     [3]    the flags, where bit 0 indicates that the thinking times are saved
+ *     [4]    the length of the open tag, i.e., "black:white"
+ *     [5]    the length of the close tag, i.e., the name of the winner
+ *     [6, 8) reserved
+ *     [8, 16) the open time, and [16, 24) the close time, in milliseconds
+ *   the open tag and the close tag
+ *   the moves, one byte each, which is the position of the move, where black moves first and the colors alternate
+ *   the thinking times of the moves (if saved), each of which is a varint, i.e., 7 bits per byte with the lowest first
+ *     and the highest bit set on all bytes but the last
+ */
+class record {
+public:
+	enum { file_header = 8, header = 24, timed = 1, version = 1 };
+
+	record(const uint8_t* data = nullptr) : data(data) {}
+
+public:
+	size_t length() const { return field(0, 2); }
+	size_t step() const { return data[2]; }
+	bool has_time() const { return data[3] & timed; }
+	std::string open_tag() const { return std::string(tags(), data[4]); }
+	std::string close_tag() const { return std::string(tags() + data[4], data[5]); }
+	time_t open_time() const { return field(8, 8); }
+	time_t close_time() const { return field(16, 8); }
+
+	/**
+	 * the positions of the moves, i.e., moves()[k] is the position of move k
+	 */
+	const uint8_t* moves() const { return data + header + data[4] + data[5]; }
+	action move(size_t k) const { return action::place(moves()[k], (k % 2) ? board::white : board::black); }
+
+	/**
+	 * the reader of the thinking times, which decodes one more time on each call of next
+	 */
+	class timing {
+	public:
+		timing(const uint8_t* p) : p(p) {}
+		time_t next() {
+			time_t time = 0;
+			unsigned shift = 0;
+			for (; p && (*p & 0x80); p++, shift += 7) time |= time_t(*p & 0x7f) << shift;
+			if (p) time |= time_t(*(p++)) << shift;
+			return time;
+		}
+	private:
+		const uint8_t* p;
+	};
+	timing times() const { return timing(has_time() ? moves() + step() : nullptr); }
+
+	/**
+	 * rebuild the episode of this record
+	 */
+	template<typename episode>
+	void load(episode& ep) const {
+		ep = {};
+		ep.ep_open = { open_tag(), open_time() };
+		ep.ep_close = { close_tag(), close_time() };
+		timing time = times();
+		for (size_t k = 0; k < step(); k++) {
+			ep.ep_moves.emplace_back(move(k), 0, time.next());
+			ep.ep_spent[k % 2] += ep.ep_moves.back().time;
+		}
+	}
+
+	/**
+	 * the binary record of an episode
+	 */
+	template<typename episode>
+	static std::string save(const episode& ep) {
+		std::string open = ep.ep_open.tag.substr(0, 255), close = ep.ep_close.tag.substr(0, 255);
+		std::string rec(header, '\0');
+		rec += open;
+		rec += close;
+		bool has_time = false;
+		for (const typename episode::move& mv : ep.ep_moves) {
+			rec += char(action::place(mv.code).position().i);
+			has_time |= mv.time != 0;
+		}
+		if (has_time) {
+			for (const typename episode::move& mv : ep.ep_moves) {
+				uint64_t time = std::max<time_t>(mv.time, 0);
+				for (; time >= 0x80; time >>= 7) rec += char(0x80 | (time & 0x7f));
+				rec += char(time);
+			}
+		}
+		put(rec, 0, 2, rec.size());
+		rec[2] = char(ep.ep_moves.size());
+		rec[3] = char(has_time ? timed : 0);
+		rec[4] = char(open.size());
+		rec[5] = char(close.size());
+		put(rec, 8, 8, ep.ep_open.when);
+		put(rec, 16, 8, ep.ep_close.when);
+		return rec;
+	}
+
+	/**
+	 * the header of a file of binary records
+	 */
+	static std::string signature() {
+		return std::string("TCGR") + char(version) + char(board::size_x) + char(board::size_y) + '\0';
+	}
+
+	/**
+	 * whether the file begins with the header of binary records
+	 */
+	static bool is_binary(const std::string& path) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		char head[4] = {};
+		return in.read(head, 4) && std::memcmp(head, "TCGR", 4) == 0;
+	}
+
+private:
+	const char* tags() const { return reinterpret_cast<const char*>(data + header); }
+
+	uint64_t field(size_t offset, size_t size) const {
+		uint64_t value = 0;
+		for (size_t i = 0; i < size; i++) value |= uint64_t(data[offset + i]) << (8 * i);
+		return value;
+	}
+	static void put(std::string& rec, size_t offset, size_t size, uint64_t value) {
+		for (size_t i = 0; i < size; i++) rec[offset + i] = char(value >> (8 * i));
+	}
+
+private:
+	const uint8_t* data;
+};
+
+/**
+ * the writer of binary records, the file header is written if the stream is at its beginning
+ */
+class record_writer {
+public:
+	record_writer(std::ostream& out) : out(out) {
+		if (out.tellp() <= 0) out << record::signature();
+	}
+
+	template<typename episode>
+	record_writer& operator <<(const episode& ep) {
+		out << record::save(ep);
+		return *this;
+	}
+
+private:
+	std::ostream& out;
+};
+
+/**
+ * the memory-mapped file of binary records, whose records are iterated as views without copying
+ *
+ * a truncated record at the end, e.g., left by an interrupted writer, ends the iteration
+ */
+class record_file {
+public:
+	record_file(const std::string& path) : base(nullptr), size(0) {
+		int fd = open(path.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && size_t(st.st_size) >= record::file_header) {
+			void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED) {
+				base = static_cast<const uint8_t*>(map);
+				size = st.st_size;
+				madvise(map, size, MADV_SEQUENTIAL);
+			}
+		}
+		if (fd >= 0) close(fd);
+		if (base && std::memcmp(base, record::signature().data(), record::file_header) != 0) {
+			munmap(const_cast<uint8_t*>(base), size);
+			base = nullptr;
+			size = 0;
+		}
+	}
+	record_file(const record_file&) = delete;
+	~record_file() {
+		if (base) munmap(const_cast<uint8_t*>(base), size);
+	}
+
+	/**
+	 * whether the file is mapped and matches the board of this build
+	 */
+	bool good() const { return base != nullptr; }
+
+	class iterator : public std::iterator<std::forward_iterator_tag, record> {
+	public:
+		iterator(const uint8_t* p, const uint8_t* end) : p(p), end(end) { check(); }
+		record operator *() const { return record(p); }
+		iterator& operator ++() { p += record(p).length(); check(); return *this; }
+		bool operator ==(const iterator& it) const { return p == it.p; }
+		bool operator !=(const iterator& it) const { return p != it.p; }
+	private:
+		void check() {
+			if (p == end) return;
+			size_t length = size_t(end - p) >= record::header ? record(p).length() : 0;
+			if (length < record::header || length > size_t(end - p)) p = end;
+		}
+		const uint8_t* p;
+		const uint8_t* end;
+	};
+	iterator begin() const { return base ? iterator(base + record::file_header, base + size) : end(); }
+	iterator end() const { return iterator(base + size, base + size); }
+
+private:
+	const uint8_t* base;
+	size_t size;
+};
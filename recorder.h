@@ -0,0 +1,138 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * recorder.h: Streaming writer that appends the closed episodes to the record file
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <functional>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "episode.h"
+#include "record.h"
+
+/**
+ * appends each episode to the record file once it is written, in the text format or the binary format
+ *
+ * each record is written in one piece and flushed, so that a killed run leaves at most a partial record
+ * at the end of the file, which is cut by recover before the file is resumed
+ * if background is set, the records are queued and written by another thread, so that the games do not wait for the disk
+ */
+class recorder {
+public:
+	recorder(const std::string& path, bool binary, bool background = false) : binary(binary), closed(false) {
+		out.open(path, std::ios::out | std::ios::app | std::ios::binary);
+		struct stat st;
+		if (binary && (stat(path.c_str(), &st) != 0 || st.st_size == 0)) {
+			out << record::signature();
+			out.flush();
+		}
+		if (background) writer = std::thread(&recorder::drain, this);
+	}
+	recorder(const recorder&) = delete;
+	~recorder() { close(); }
+
+	void write(const episode& ep) {
+		std::string rec = binary ? record::save(ep) : text(ep);
+		if (writer.joinable()) {
+			std::lock_guard<std::mutex> lock(queue);
+			pending.push_back(std::move(rec));
+			arrival.notify_one();
+		} else {
+			out << rec;
+			out.flush();
+		}
+	}
+
+	/**
+	 * write the remaining records and close the file
+	 */
+	void close() {
+		if (writer.joinable()) {
+			std::unique_lock<std::mutex> lock(queue);
+			closed = true;
+			arrival.notify_one();
+			lock.unlock();
+			writer.join();
+		}
+		if (out.is_open()) out.close();
+	}
+
+	bool good() const { return out.good(); }
+
+public:
+	/**
+	 * read the complete records of the file one by one, and cut the partial record at the end if any
+	 * return the number of the complete records
+	 */
+	static size_t recover(const std::string& path, const std::function<void(episode&&)>& load) {
+		size_t games = 0;
+		off_t valid = 0;
+		episode ep;
+		if (record::is_binary(path)) {
+			record_file file(path);
+			if (!file.good()) return 0;
+			valid = record::file_header;
+			for (record rec : file) {
+				rec.load(ep);
+				load(std::move(ep));
+				valid += rec.length();
+				games++;
+			}
+		} else {
+			std::ifstream in(path, std::ios::in | std::ios::binary);
+			for (std::string line; std::getline(in, line) && !in.eof() && line.size(); ) {
+				if (!(std::stringstream(line) >> ep)) break;
+				load(std::move(ep));
+				valid = in.tellg();
+				games++;
+			}
+		}
+		struct stat st;
+		if (stat(path.c_str(), &st) == 0 && st.st_size > valid && truncate(path.c_str(), valid) != 0)
+			std::cerr << "cannot cut the partial record of " << path << std::endl;
+		return games;
+	}
+
+private:
+	static std::string text(const episode& ep) {
+		std::stringstream line;
+		line << ep << std::endl;
+		return line.str();
+	}
+
+	void drain() {
+		std::unique_lock<std::mutex> lock(queue);
+		while (true) {
+			arrival.wait(lock, [this]() { return pending.size() || closed; });
+			if (pending.empty()) break;
+			std::deque<std::string> batch;
+			batch.swap(pending);
+			lock.unlock();
+			for (const std::string& rec : batch) out << rec;
+			out.flush();
+			lock.lock();
+		}
+	}
+
+private:
+	std::ofstream out;
+	bool binary;
+	std::thread writer;
+	std::deque<std::string> pending;
+	bool closed;
+	std::mutex queue;
+	std::condition_variable arrival;
+};
@@ -0,0 +1,108 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * scheduler.h: Thread pool that runs independent jobs with work stealing
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+/**
+ * runs jobs 0, 1, ..., n - 1 on a fixed number of threads
+ *
+ * the jobs are dealt to the queues of the workers in turns, so that the early jobs finish early;
+ * each worker takes the jobs from the front of its own queue, and once its queue is empty,
+ * steals a job from the back of the queue of another worker, so that no worker idles while jobs remain
+ *
+ * if a job throws, the jobs not yet started are skipped, and the exception is rethrown by join on the calling thread
+ */
+class work_stealing_pool {
+public:
+	work_stealing_pool(size_t workers) : queues(std::max<size_t>(workers, 1)) {
+		for (auto& q : queues) q.reset(new queue);
+	}
+	work_stealing_pool(const work_stealing_pool&) = delete;
+	~work_stealing_pool() {
+		for (std::thread& thread : threads) thread.join();
+	}
+
+	/**
+	 * start running job(worker, i) for each job i in [0, n) on the threads, where worker is the index of the thread
+	 */
+	template<typename function>
+	void launch(size_t n, function job) {
+		for (size_t i = 0; i < n; i++) queues[i % queues.size()]->jobs.push_back(i);
+		for (size_t w = 0; w < queues.size(); w++) {
+			threads.emplace_back([this, w, job]() {
+				try {
+					for (size_t i; take(w, i); job(w, i));
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(failure);
+					if (!error) error = std::current_exception();
+				}
+			});
+		}
+	}
+
+	/**
+	 * wait until all the jobs are done
+	 */
+	void join() {
+		for (std::thread& thread : threads) thread.join();
+		threads.clear();
+		std::exception_ptr thrown;
+		std::swap(thrown, error);
+		if (thrown) std::rethrow_exception(thrown);
+	}
+
+	/**
+	 * whether a job has thrown
+	 */
+	bool failed() {
+		std::lock_guard<std::mutex> lock(failure);
+		return error != nullptr;
+	}
+
+	size_t size() const { return queues.size(); }
+
+private:
+	/**
+	 * take the next job of the worker, or steal one from the others, return false if no job remains
+	 */
+	bool take(size_t w, size_t& i) {
+		if (failed()) return false;
+		for (size_t k = 0; k < queues.size(); k++) {
+			queue& q = *queues[(w + k) % queues.size()];
+			std::lock_guard<std::mutex> lock(q.lock);
+			if (q.jobs.empty()) continue;
+			if (k == 0) {
+				i = q.jobs.front();
+				q.jobs.pop_front();
+			} else {
+				i = q.jobs.back();
+				q.jobs.pop_back();
+			}
+			return true;
+		}
+		return false;
+	}
+
+private:
+	struct queue {
+		std::deque<size_t> jobs;
+		std::mutex lock;
+	};
+	std::vector<std::unique_ptr<queue>> queues;
+	std::vector<std::thread> threads;
+	std::exception_ptr error; // the first exception thrown by the jobs
+	std::mutex failure;
+};
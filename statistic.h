@@ -8,10 +8,11 @@
  */
 
 #pragma once
-#include <list>
+#include <vector>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <functional>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
@@ -41,6 +42,7 @@ public:
 	 *
 	 * where (block = 1000 by default)
 	 *  '1000': current index (n), i.e., this line is the statistic of game 1 ~ 1000
+	 *          (the games of the current block, which are accumulated as they are closed)
 	 *  'win = 53.5%|46.5%': the win rate for black is 53.5%; for white is 46.5%
 	 *  'op = 74.451 (37.493|36.958)': the average move is 74.451
 	 *                                 the average move of black is 37.493
@@ -50,91 +52,202 @@ public:
 	 *                                  the average speed of white is 135377
 	 */
 	void show() const {
-		size_t blk = std::min(data.size(), block);
-		size_t sop = 0, Bop = 0, Wop = 0;
-		time_t sdu = 0, Bdu = 0, Wdu = 0;
-		size_t BW = 0, WW = 0;
-		auto it = data.end();
-		for (size_t i = 0; i < blk; i++) {
-			auto& ep = *(--it);
-			if (ep.ep_moves.size() % 2 == 1) BW++;
-			else                             WW++;
-			sop += ep.step();
-			Bop += ep.step(action::black::type);
-			Wop += ep.step(action::white::type);
-			sdu += ep.time();
-			Bdu += ep.time(action::black::type);
-			Wdu += ep.time(action::white::type);
-		}
-
-		std::cout << count << "\t";
-		std::cout << "win = " << (BW * 100.0 / blk) << "%"
-		          <<      "|" << (WW * 100.0 / blk) << "%, ";
-		std::cout << "op = "  << (sop * 1.0 / blk)
-		          <<     " (" << (Bop * 1.0 / blk)
-		          <<      "|" << (Wop * 1.0 / blk) << "), ";
-		std::cout << "ops = " << (sop * 1000.0 / sdu)
-		          <<     " (" << (Bop * 1000.0 / Bdu)
-		          <<      "|" << (Wop * 1000.0 / Wdu) << ")";
-		std::cout << std::endl;
+		show(window);
 	}
 
+	/**
+	 * show the statistic of all the saved records
+	 */
 	void summary() const {
-		auto block_temp = block;
-		const_cast<statistic&>(*this).block = data.size();
-		show();
-		const_cast<statistic&>(*this).block = block_temp;
+		show(kept);
 	}
 
 	bool is_finished() const {
 		return count >= total;
 	}
 
+	size_t remaining() const {
+		return total - std::min(count, total);
+	}
+
 	bool is_episode_ongoing() const {
-		return data.size() && data.back().ep_close.when == 0;
+		return data.size() && back().ep_close.when == 0;
 	}
 
 	void open_episode(const std::string& flag = "") {
-		if (count++ >= limit) data.pop_front();
-		data.emplace_back();
-		data.back().open_episode(flag);
+		allocate() = {};
+		back().open_episode(flag);
 	}
 
 	void close_episode(const std::string& flag = "") {
-		data.back().close_episode(flag);
+		back().close_episode(flag);
+		accumulate(back());
+		if (sink) sink(back());
+		if (count % block == 0) show();
+	}
+
+	/**
+	 * add an episode that has been played elsewhere, e.g., by a parallel worker
+	 */
+	void add_episode(episode&& ep) {
+		allocate() = std::move(ep);
+		accumulate(back());
+		if (sink) sink(back());
 		if (count % block == 0) show();
 	}
 
+	/**
+	 * the saved records, from the oldest (at 0) to the newest
+	 */
+	size_t size() const {
+		return data.size();
+	}
 	episode& at(size_t i) {
-		auto it = data.begin();
-		while (i--) it++;
-		return *it;
+		return data[(oldest() + i) % data.size()];
+	}
+	const episode& at(size_t i) const {
+		return data[(oldest() + i) % data.size()];
 	}
 	episode& front() {
-		return data.front();
+		return at(0);
 	}
 	episode& back() {
-		return data.back();
+		return data[(count - 1) % data.size()];
+	}
+	const episode& back() const {
+		return data[(count - 1) % data.size()];
 	}
 
 	friend std::ostream& operator <<(std::ostream& out, const statistic& stat) {
-		for (const episode& rec : stat.data) out << rec << std::endl;
+		for (size_t i = 0; i < stat.size(); i++) out << stat.at(i) << std::endl;
 		return out;
 	}
 	friend std::istream& operator >>(std::istream& in, statistic& stat) {
+		std::vector<episode> records;
 		for (std::string line; std::getline(in, line) && line.size(); ) {
-			stat.data.emplace_back();
-			std::stringstream(line) >> stat.data.back();
+			records.emplace_back();
+			std::stringstream(line) >> records.back();
 		}
-		stat.total = std::max(stat.total, stat.data.size());
-		stat.count = stat.data.size();
+		stat.load(records);
 		return in;
 	}
 
+	/**
+	 * load the records into an empty statistic, where the limit is raised so that all of them are kept
+	 */
+	void load(std::vector<episode>& records) {
+		limit = std::max(limit, count + records.size());
+		for (episode& rec : records) load(std::move(rec));
+		total = std::max(total, count);
+	}
+
+	/**
+	 * load a record that was played by a previous run, without raising the limit
+	 */
+	void load(episode&& rec) {
+		allocate() = std::move(rec);
+		accumulate(back());
+	}
+
+	/**
+	 * pass each episode to the sink once it is closed, e.g., to write it to the record file
+	 */
+	void stream(const std::function<void(const episode&)>& sink) {
+		this->sink = sink;
+	}
+
+protected:
+	/**
+	 * the aggregates of some closed episodes, indexed by 0 for black and 1 for white
+	 */
+	struct tally {
+		size_t games = 0;
+		size_t wins[2] = {};
+		size_t steps[2] = {};
+		time_t times[2] = {};
+		time_t duration = 0;
+
+		tally() = default;
+		tally(const episode& ep) : games(1), duration(ep.time()) {
+			wins[ep.step() % 2 == 1 ? 0 : 1] = 1; // the last mover wins
+			steps[0] = ep.step(action::black::type);
+			steps[1] = ep.step(action::white::type);
+			times[0] = ep.time(action::black::type);
+			times[1] = ep.time(action::white::type);
+		}
+		tally& operator +=(const tally& t) {
+			games += t.games;
+			duration += t.duration;
+			for (int i = 0; i < 2; i++) {
+				wins[i] += t.wins[i];
+				steps[i] += t.steps[i];
+				times[i] += t.times[i];
+			}
+			return *this;
+		}
+		tally& operator -=(const tally& t) {
+			games -= t.games;
+			duration -= t.duration;
+			for (int i = 0; i < 2; i++) {
+				wins[i] -= t.wins[i];
+				steps[i] -= t.steps[i];
+				times[i] -= t.times[i];
+			}
+			return *this;
+		}
+	};
+
+	void show(const tally& t) const {
+		size_t blk = t.games;
+		size_t sop = t.steps[0] + t.steps[1];
+		std::cout << count << "\t";
+		std::cout << "win = " << (t.wins[0] * 100.0 / blk) << "%"
+		          <<      "|" << (t.wins[1] * 100.0 / blk) << "%, ";
+		std::cout << "op = "  << (sop * 1.0 / blk)
+		          <<     " (" << (t.steps[0] * 1.0 / blk)
+		          <<      "|" << (t.steps[1] * 1.0 / blk) << "), ";
+		std::cout << "ops = " << (sop * 1000.0 / t.duration)
+		          <<     " (" << (t.steps[0] * 1000.0 / t.times[0])
+		          <<      "|" << (t.steps[1] * 1000.0 / t.times[1]) << ")";
+		std::cout << std::endl;
+	}
+
+	/**
+	 * the slot of a new episode, which overwrites the oldest one once (limit) records are saved
+	 * the slots are allocated on demand, and the episode of game n is always kept at slot n % limit
+	 */
+	episode& allocate() {
+		if (data.size() < limit) {
+			data.emplace_back();
+		} else {
+			const episode& evicted = data[count % data.size()];
+			if (evicted.ep_close.when) kept -= tally(evicted);
+		}
+		count++;
+		return back();
+	}
+
+	/**
+	 * accumulate a closed episode, the aggregates of the block restart with its first game
+	 */
+	void accumulate(const episode& ep) {
+		tally t(ep);
+		if (block == 0 || (count - 1) % block == 0) window = {};
+		window += t;
+		kept += t;
+	}
+
+	size_t oldest() const {
+		return data.size() < limit ? 0 : count % data.size();
+	}
+
 private:
 	size_t total;
 	size_t block;
 	size_t limit;
 	size_t count;
-	std::list<episode> data;
+	std::vector<episode> data; // the ring buffer of the saved records
+	tally window; // the aggregates of the current block
+	tally kept; // the aggregates of the saved records
+	std::function<void(const episode&)> sink;
 };
@@ -0,0 +1,151 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * timer.h: Allocate the thinking time of each move from the remaining time of the game
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <chrono>
+#include <algorithm>
+
+/**
+ * a time manager measures the wall time with steady_clock, and follows the time system of GTP,
+ * i.e., the main time followed by canadian byo-yomi periods of (byoyomi_time) for every (byoyomi_stones) moves
+ *
+ * the budget of a move is the remaining time divided by the expected number of moves left,
+ * the search may stop before the budget once the best move is settled, i.e., no other move can
+ * catch up with its visits in the remaining budget, or go beyond the budget while the best move keeps changing
+ * without any time settings, each move is given a fixed budget, and the time saved by the moves
+ * that stop early is banked, a quarter of which is added to the budget of the next move
+ */
+class time_manager {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	time_manager(double per_move = 1) : main_time(0), byoyomi_time(0), byoyomi_stones(0), limited(false),
+		remaining(0), stones(0), per_move(per_move), banked(0), budget(per_move), maximum(per_move), stable_since(0), reason("") {}
+
+	/**
+	 * the GTP time_settings command, note that a positive byo-yomi time with no stones means no time limit
+	 */
+	void settings(double main, double byoyomi, unsigned byoyomi_stones) {
+		this->main_time = main;
+		this->byoyomi_time = byoyomi;
+		this->byoyomi_stones = byoyomi_stones;
+		limited = !(byoyomi > 0 && byoyomi_stones == 0);
+		reset();
+	}
+
+	/**
+	 * the GTP time_left command, the remaining time of the main time (stones == 0) or the current byo-yomi period
+	 */
+	void left(double time, unsigned stones) {
+		remaining = time;
+		this->stones = stones;
+	}
+
+	/**
+	 * restore the time for a new game
+	 */
+	void reset() {
+		remaining = main_time;
+		stones = 0;
+		banked = 0;
+	}
+
+public:
+	/**
+	 * start thinking for a move, with the expected number of own moves left in the game
+	 */
+	void start(unsigned moves_left) {
+		begin = clock::now();
+		stable_since = 0;
+		reason = "";
+		if (!limited) {
+			budget = per_move + banked / 4;
+			maximum = per_move + banked / 2;
+			return;
+		}
+		double period = byoyomi_stones ? byoyomi_time / byoyomi_stones : 0;
+		if (stones) { // in byo-yomi, spend the period evenly
+			budget = maximum = std::max(remaining - margin(remaining), 0.0) / stones;
+		} else {
+			double usable = std::max(remaining - margin(remaining), 0.0);
+			budget = usable / std::max(moves_left, 1u) + period * 0.8;
+			maximum = std::min(budget * 3, usable / 4 + period * 0.8);
+			maximum = std::max(maximum, budget);
+		}
+		budget = std::max(budget, 0.01);
+		maximum = std::max(maximum, 0.01);
+	}
+
+	/**
+	 * whether to continue the search, given the visits of the best and the second best moves,
+	 * whether the best move has changed since the last call, and the number of simulations so far
+	 * the search stops early only if the move is chosen by visits (by_visits), otherwise the move may still change
+	 */
+	bool keep_searching(double best, double second, bool changed, double simulations, bool by_visits = true) {
+		double spent = elapsed();
+		if (changed) stable_since = spent;
+		if (spent >= maximum) return stop("out of time");
+		if (spent >= budget) { // extend while the best move is unstable
+			return spent - stable_since < budget / 4 || stop("out of budget");
+		}
+		if (by_visits && spent >= budget / 4 && simulations > 0) { // stop early if the best move is settled
+			double more = simulations / spent * (budget - spent);
+			if (best - second > more) return stop("settled");
+		}
+		return true;
+	}
+
+	/**
+	 * finish thinking for a move, the time spent is deducted until the next time_left
+	 */
+	void finish() {
+		if (!limited) {
+			banked = std::max(banked + per_move - elapsed(), 0.0);
+			return;
+		}
+		remaining -= elapsed();
+		if (stones) {
+			if (--stones == 0 || remaining <= 0) {
+				remaining = byoyomi_time;
+				stones = byoyomi_stones;
+			}
+		} else if (remaining <= 0 && byoyomi_stones) {
+			remaining += byoyomi_time;
+			stones = byoyomi_stones;
+		}
+	}
+
+	double elapsed() const { return std::chrono::duration<double>(clock::now() - begin).count(); }
+	double allocated() const { return budget; }
+	const char* stopped() const { return reason; } // why the last search stopped, or empty if it is going on
+
+
+private:
+	bool stop(const char* why) {
+		reason = why;
+		return false;
+	}
+	static double margin(double time) { return std::min(0.05 * time, 0.5) + 0.05; } // for the latency of the communication
+
+	double main_time;
+	double byoyomi_time;
+	unsigned byoyomi_stones;
+	bool limited;
+
+	double remaining; // the remaining time of the main time or the current byo-yomi period
+	unsigned stones; // the number of moves left in the current byo-yomi period, or 0 if in the main time
+
+	double per_move; // the budget of each move if there is no time limit
+	double banked; // the time saved by the previous moves if there is no time limit
+	double budget;
+	double maximum;
+	clock::time_point begin;
+	double stable_since; // when the best move last changed, in seconds since the beginning
+	const char* reason;
+};
@@ -0,0 +1,204 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * tournament.h: Round-robin tournament with Elo estimates and sequential probability ratio tests
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cmath>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <limits>
+#include <numeric>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include "agent.h"
+#include "episode.h"
+#include "statistic.h"
+#include "scheduler.h"
+
+/**
+ * conversions between the rating difference and the expected score of the logistic Elo model
+ */
+struct elo {
+	static double score(double diff) { return 1 / (1 + std::pow(10, -diff / 400)); }
+	static double diff(double score) { return -400 * std::log10(1 / score - 1); }
+};
+
+/**
+ * the sequential probability ratio test of H0: the rating difference is elo0, against H1: it is elo1,
+ * with the probabilities of the type I and type II errors alpha and beta
+ * the log-likelihood ratio is accumulated game by game, and the test is decisive once it leaves (lower, upper)
+ */
+class sprt {
+public:
+	sprt(double elo0 = -10, double elo1 = 10, double alpha = 0.05, double beta = 0.05) :
+		lower(std::log(beta / (1 - alpha))), upper(std::log((1 - beta) / alpha)),
+		win(std::log(elo::score(elo1) / elo::score(elo0))),
+		loss(std::log((1 - elo::score(elo1)) / (1 - elo::score(elo0)))), llr(0) {}
+
+	void add(bool won) { llr += won ? win : loss; }
+
+	/**
+	 * 1 if H1 is accepted, -1 if H0 is accepted, or 0 if more games are needed
+	 */
+	int decision() const { return llr >= upper ? 1 : (llr <= lower ? -1 : 0); }
+	double ratio() const { return llr; }
+
+private:
+	double lower, upper; // the bounds of the log-likelihood ratio
+	double win, loss; // the log-likelihood ratios of a win and a loss
+	double llr;
+};
+
+/**
+ * a round-robin tournament of several player configurations
+ *
+ * each pair of entrants plays up to (games) games with alternating colors, and stops early once its sprt
+ * is decisive, which is checked after each pair of games so that both sides play both colors equally;
+ * the pairings are run in parallel on a work-stealing pool, each with its own players
+ *
+ * the result of each pairing is shown with its rating difference and the 95% confidence interval,
+ * and the summary shows the ratings of all entrants fitted by the Bradley-Terry model
+ */
+class tournament {
+public:
+	typedef std::function<void(agent& black, agent& white, statistic& stat)> game_type;
+
+	/**
+	 * entrants are the arguments of the players, the sprt is given as "elo0,elo1,alpha,beta"
+	 * the progress of a pairing is shown every (block) games if block is nonzero
+	 */
+	tournament(const std::vector<std::string>& entrants, size_t games, const std::string& test = "", size_t block = 0) :
+		entrants(entrants), games(games), block(block) {
+		for (size_t i = 0; i < entrants.size(); i++) {
+			names.push_back(agent("name=agent" + std::to_string(i + 1) + " " + entrants[i]).name());
+		}
+		double elo0 = -10, elo1 = 10, alpha = 0.05, beta = 0.05;
+		std::stringstream in(test);
+		char comma;
+		in >> elo0 >> comma >> elo1 >> comma >> alpha >> comma >> beta;
+		for (size_t a = 0; a < entrants.size(); a++) {
+			for (size_t b = a + 1; b < entrants.size(); b++) {
+				pairings.push_back({ a, b, 0, 0, sprt(elo0, elo1, alpha, beta) });
+			}
+		}
+	}
+
+	/**
+	 * play all the pairings with the given game procedure on (parallel) threads
+	 */
+	void run(const game_type& play, size_t parallel = 1) {
+		work_stealing_pool pool(parallel);
+		pool.launch(pairings.size(), [&](size_t, size_t i) { match(pairings[i], play); });
+		pool.join();
+	}
+
+	/**
+	 * show the ratings of the entrants, with the mean rating as 0
+	 */
+	void summary() const {
+		std::vector<double> rating = fit();
+		std::vector<size_t> rank(entrants.size());
+		std::iota(rank.begin(), rank.end(), 0);
+		std::sort(rank.begin(), rank.end(), [&](size_t x, size_t y) { return rating[x] > rating[y]; });
+		for (size_t i : rank) {
+			size_t won = 0, played = 0;
+			for (const pairing& p : pairings) {
+				if (p.a == i) won += p.wins;
+				if (p.b == i) won += p.games - p.wins;
+				if (p.a == i || p.b == i) played += p.games;
+			}
+			std::stringstream line;
+			line << names[i] << "\t" << "elo = " << std::showpos << std::fixed << std::setprecision(1) << rating[i]
+			     << std::noshowpos << ", games = " << played << " (" << won << "|" << (played - won) << ")";
+			std::cout << line.str() << std::endl;
+		}
+	}
+
+protected:
+	struct pairing {
+		size_t a, b; // the indices of the entrants
+		size_t wins, games; // the wins of entrant a, and the games played
+		sprt test; // whether entrant a is stronger than entrant b
+	};
+
+	void match(pairing& p, const game_type& play) {
+		player a_black("name=" + names[p.a] + " " + entrants[p.a] + " role=black");
+		player a_white("name=" + names[p.a] + " " + entrants[p.a] + " role=white");
+		player b_black("name=" + names[p.b] + " " + entrants[p.b] + " role=black");
+		player b_white("name=" + names[p.b] + " " + entrants[p.b] + " role=white");
+		statistic stat(std::numeric_limits<size_t>::max(), 0, 1); // only the game in progress is kept
+		for (size_t n = 0; n < games; n++) {
+			bool swapped = n % 2; // entrant a plays black in the even games
+			play(swapped ? b_black : a_black, swapped ? a_white : b_white, stat);
+			bool won = (stat.back().step() % 2 == 1) != swapped; // the last mover wins
+			std::lock_guard<std::mutex> lock(output);
+			p.wins += won ? 1 : 0;
+			p.games += 1;
+			p.test.add(won);
+			bool decisive = swapped && p.test.decision() != 0;
+			if (decisive || n + 1 == games || (block && p.games % block == 0)) show(p);
+			if (decisive) break;
+		}
+	}
+
+	/**
+	 * show the result of a pairing, e.g., "agent1:agent2  games = 60 (37|23), elo = +70.4 [-20.1, +160.3], llr = 2.96 (agent1)"
+	 * where the rating difference of agent1 over agent2 is given with its 95% confidence interval,
+	 * and the entrant in the parentheses is accepted as the stronger one by the sprt
+	 */
+	void show(const pairing& p) const {
+		double n = p.games, s = (p.wins + 0.5) / (n + 1); // with a virtual draw to avoid infinite ratings
+		double margin = 1.96 * std::sqrt(s * (1 - s) / n);
+		double low = std::max(s - margin, 0.5 / (n + 1)), high = std::min(s + margin, 1 - 0.5 / (n + 1));
+		std::stringstream line;
+		line << names[p.a] << ":" << names[p.b] << "\t" << "games = " << p.games
+		     << " (" << p.wins << "|" << (p.games - p.wins) << "), " << std::fixed << std::setprecision(1) << std::showpos
+		     << "elo = " << elo::diff(s) << " [" << elo::diff(low) << ", " << elo::diff(high) << "], "
+		     << std::setprecision(2) << "llr = " << p.test.ratio() << std::noshowpos;
+		if (p.test.decision()) line << " (" << names[p.test.decision() > 0 ? p.a : p.b] << ")";
+		std::cout << line.str() << std::endl;
+	}
+
+	/**
+	 * fit the ratings by the minorization-maximization of the Bradley-Terry model,
+	 * with a virtual draw in each pairing so that every rating is finite
+	 */
+	std::vector<double> fit() const {
+		std::vector<double> gamma(entrants.size(), 1), wins(entrants.size(), 0);
+		for (const pairing& p : pairings) {
+			wins[p.a] += p.wins + 0.5;
+			wins[p.b] += p.games - p.wins + 0.5;
+		}
+		for (unsigned n = 0; n < 1000; n++) {
+			std::vector<double> sum(entrants.size(), 0);
+			for (const pairing& p : pairings) {
+				double c = (p.games + 1) / (gamma[p.a] + gamma[p.b]);
+				sum[p.a] += c;
+				sum[p.b] += c;
+			}
+			for (size_t i = 0; i < gamma.size(); i++) gamma[i] = sum[i] > 0 ? wins[i] / sum[i] : 1;
+		}
+		std::vector<double> rating(entrants.size());
+		for (size_t i = 0; i < rating.size(); i++) rating[i] = 400 * std::log10(gamma[i]);
+		double mean = std::accumulate(rating.begin(), rating.end(), 0.0) / std::max<size_t>(rating.size(), 1);
+		for (double& r : rating) r -= mean;
+		return rating;
+	}
+
+private:
+	std::vector<std::string> entrants;
+	std::vector<std::string> names;
+	std::vector<pairing> pairings;
+	size_t games;
+	size_t block;
+	std::mutex output; // held while updating the results and showing them
+};
@@ -0,0 +1,98 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * transposition.h: Fixed-size hash table for sharing search results between transposed positions
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+/**
+ * a transposition table maps 64-bit position hashes to values
+ *
+ * the table is an array of buckets, each bucket fills exactly one cache line
+ * and holds several (key, value) slots, so that a lookup touches only one cache line
+ * existing entries are never replaced, i.e., insertion fails once the bucket is full
+ * note that key 0 marks an empty slot, so it is stored as key 1 internally
+ */
+template<typename value_type>
+class transposition_table {
+public:
+	static constexpr size_t cache_line = 64;
+	static constexpr size_t slots = cache_line / (sizeof(uint64_t) + sizeof(value_type));
+
+	/**
+	 * allocate a table with at least the given number of slots
+	 */
+	transposition_table(size_t capacity = 0) : table(nullptr), mask(0), used(0) {
+		size_t buckets = 1;
+		while (buckets * slots < capacity) buckets <<= 1;
+		void* space = nullptr;
+		if (posix_memalign(&space, cache_line, buckets * sizeof(bucket)) != 0) throw std::bad_alloc();
+		table = static_cast<bucket*>(space);
+		mask = buckets - 1;
+		std::memset(table, 0, buckets * sizeof(bucket));
+	}
+	transposition_table(const transposition_table&) = delete;
+	transposition_table& operator =(const transposition_table&) = delete;
+	~transposition_table() { std::free(table); }
+
+public:
+	/**
+	 * find the value stored with the key, return nullptr if not found
+	 */
+	value_type* find(uint64_t key) {
+		key = key ? key : 1;
+		bucket& b = table[key & mask];
+		for (size_t i = 0; i < slots && b.key[i]; i++) {
+			if (b.key[i] == key) return &b.value[i];
+		}
+		return nullptr;
+	}
+
+	/**
+	 * store a value with the key, return false if the bucket is full
+	 */
+	bool insert(uint64_t key, const value_type& value) {
+		key = key ? key : 1;
+		bucket& b = table[key & mask];
+		for (size_t i = 0; i < slots; i++) {
+			if (b.key[i] == 0) {
+				b.key[i] = key;
+				b.value[i] = value;
+				used++;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * remove all the entries, note that an unused table is not touched
+	 */
+	void clear() {
+		if (used == 0) return;
+		std::memset(table, 0, (mask + 1) * sizeof(bucket));
+		used = 0;
+	}
+
+	size_t size() const { return used; }
+	size_t capacity() const { return (mask + 1) * slots; }
+
+private:
+	struct alignas(cache_line) bucket {
+		uint64_t key[slots];
+		value_type value[slots];
+	};
+	static_assert(sizeof(bucket) == cache_line, "a bucket should fill exactly one cache line");
+
+	bucket* table;
+	size_t mask;
+	size_t used;
+};